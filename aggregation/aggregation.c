@@ -0,0 +1,345 @@
+#include "aggregation.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <string.h>
+
+/** Rows whose groups are resolved together before their values are folded in. */
+#define AGG_BATCH 64
+/** Group number of a key that was not found. */
+#define AGG_NONE ((size_t)-1)
+
+#define AGG_ITEM(vec, index) ((char *)(vec)->items + ((index) * (vec)->e_size))
+
+bool agg_init(const size_t key_size, const size_t column_count, const size_t capacity, const hash_func hash, const cmp_func cmp, struct aggregation *agg)
+{
+    if (key_size == 0 || capacity == 0 || !cmp || !agg) {
+        return false;
+    }
+
+    hm_init(key_size, sizeof(size_t), capacity, hash, cmp, &agg->groups);
+    if (!agg->groups.table) {
+        return false;
+    }
+
+    agg->keys.items = NULL;
+    agg->counts.items = NULL;
+    agg->states.items = NULL;
+    const size_t state_capacity = column_count ? capacity * column_count : 1;
+
+    if (!vector_initialize(capacity, key_size, &agg->keys)
+        || !vector_initialize(capacity, sizeof(size_t), &agg->counts)
+        || !vector_initialize(state_capacity, sizeof(struct agg_state), &agg->states)) {
+        agg_destroy(agg);
+        return false;
+    }
+
+    agg->column_count = column_count;
+    agg->key_size = key_size;
+    return true;
+}
+
+/**
+ * @brief Finds the group of a key, adding an empty group if the key is new.
+ *
+ * @return Number of the group, AGG_NONE if out of memory.
+ */
+static size_t agg_group_of(struct aggregation *agg, const void *key)
+{
+    bool inserted;
+    size_t *slot = hm_get_or_insert(&agg->groups, key, &inserted);
+    if (!slot) {
+        return AGG_NONE;
+    }
+    if (!inserted) {
+        return *slot;
+    }
+
+    const size_t group = agg->keys.size;
+    const size_t count = 0;
+    const struct agg_state empty = {0.0, INFINITY, -INFINITY};
+    *slot = group;
+
+    bool ok = vector_push_back(&agg->keys, key) && vector_push_back(&agg->counts, &count);
+    for (size_t c = 0; ok && c < agg->column_count; c++) {
+        ok = vector_push_back(&agg->states, &empty);
+    }
+
+    if (!ok) {
+        // Keep the group vectors the same length for the next attempt.
+        hm_delete(&agg->groups, key);
+        agg->keys.size = group;
+        agg->counts.size = group;
+        agg->states.size = group * agg->column_count;
+        return AGG_NONE;
+    }
+    return group;
+}
+
+/**
+ * @brief Removes the groups numbered `group_count` and above, undoing agg_group_of.
+ */
+static void agg_truncate(struct aggregation *agg, const size_t group_count)
+{
+    for (size_t g = group_count; g < agg->keys.size; g++) {
+        hm_delete(&agg->groups, AGG_ITEM(&agg->keys, g));
+    }
+
+    agg->keys.size = group_count;
+    agg->counts.size = group_count;
+    agg->states.size = group_count * agg->column_count;
+}
+
+/**
+ * @brief Folds `count` values into their groups' aggregates of one column.
+ */
+static void agg_fold(struct aggregation *agg, const size_t column, const double *values, const size_t *groups, const size_t count)
+{
+    struct agg_state *states = (struct agg_state *)agg->states.items + column;
+    const size_t stride = agg->column_count;
+
+    for (size_t i = 0; i < count; i++) {
+        struct agg_state *state = &states[groups[i] * stride];
+        const double value = values[i];
+        state->sum += value;
+        state->min = value < state->min ? value : state->min;
+        state->max = value > state->max ? value : state->max;
+    }
+}
+
+/**
+ * @brief Aggregates the rows [first, first + count) of the columns.
+ *
+ * @return true if successful, false otherwise.
+ */
+static bool agg_update_rows(struct aggregation *agg, const struct vector *keys, const struct vector *const *columns, const size_t first, const size_t count)
+{
+    void *found[AGG_BATCH];
+    size_t groups[AGG_BATCH];
+
+    for (size_t start = first; start < first + count; start += AGG_BATCH) {
+        const size_t n = first + count - start < AGG_BATCH ? first + count - start : AGG_BATCH;
+        const char *key_batch = AGG_ITEM(keys, start);
+
+        hm_get_many(&agg->groups, key_batch, n, found);
+
+        // Copy the group numbers out before adding groups moves the table entries.
+        for (size_t i = 0; i < n; i++) {
+            groups[i] = found[i] ? *(const size_t *)found[i] : AGG_NONE;
+        }
+
+        for (size_t i = 0; i < n; i++) {
+            if (groups[i] != AGG_NONE) {
+                continue;
+            }
+
+            // The key may have been added by an earlier row of the batch.
+            groups[i] = agg_group_of(agg, key_batch + i * agg->key_size);
+            if (groups[i] == AGG_NONE) {
+                return false;
+            }
+        }
+
+        size_t *counts = agg->counts.items;
+        for (size_t i = 0; i < n; i++) {
+            counts[groups[i]]++;
+        }
+
+        for (size_t c = 0; c < agg->column_count; c++) {
+            agg_fold(agg, c, (const double *)columns[c]->items + start, groups, n);
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Checks that the columns match the aggregation and each other.
+ */
+static bool agg_check_columns(const struct aggregation *agg, const struct vector *keys, const struct vector *const *columns)
+{
+    if (!keys || keys->e_size != agg->key_size || (agg->column_count && !columns)) {
+        return false;
+    }
+
+    for (size_t c = 0; c < agg->column_count; c++) {
+        if (!columns[c] || columns[c]->e_size != sizeof(double) || columns[c]->size != keys->size) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool agg_update(struct aggregation *agg, const struct vector *keys, const struct vector *const *columns)
+{
+    if (!agg || !agg_check_columns(agg, keys, columns)) {
+        return false;
+    }
+
+    return agg_update_rows(agg, keys, columns, 0, keys->size);
+}
+
+/**
+ * @struct agg_task
+ * @brief  Slice of rows aggregated by one thread.
+ */
+struct agg_task {
+    /** Thread-local aggregation of the slice. */
+    struct aggregation local;
+    /** Key column. */
+    const struct vector *keys;
+    /** Value columns. */
+    const struct vector *const *columns;
+    /** First row of the slice. */
+    size_t first;
+    /** Number of rows in the slice. */
+    size_t count;
+    /** Whether the slice was aggregated. */
+    bool ok;
+};
+
+static void *agg_worker(void *arg)
+{
+    struct agg_task *task = arg;
+    task->ok = agg_update_rows(&task->local, task->keys, task->columns, task->first, task->count);
+    return NULL;
+}
+
+bool agg_update_parallel(struct aggregation *agg, const struct vector *keys, const struct vector *const *columns, const size_t thread_count)
+{
+    if (!agg || thread_count == 0 || !agg_check_columns(agg, keys, columns)) {
+        return false;
+    }
+
+    // Small batches are aggregated by a single partial, threads would cost more than they save.
+    const size_t rows = keys->size;
+    const size_t workers = rows < thread_count * AGG_BATCH ? 1 : thread_count;
+
+    struct agg_task *tasks = calloc(workers, sizeof(struct agg_task));
+    pthread_t *threads = calloc(workers, sizeof(pthread_t));
+    if (!tasks || !threads) {
+        free(tasks);
+        free(threads);
+        return false;
+    }
+
+    const size_t slice = rows / workers;
+    const size_t local_capacity = agg->groups.capacity / workers ? agg->groups.capacity / workers : 1;
+    size_t started = 0;
+    bool ok = true;
+
+    for (; started < workers; started++) {
+        struct agg_task *task = &tasks[started];
+        task->keys = keys;
+        task->columns = columns;
+        task->first = started * slice;
+        task->count = started + 1 == workers ? rows - task->first : slice;
+
+        if (!agg_init(agg->key_size, agg->column_count, local_capacity, agg->groups.hash, agg->groups.cmp, &task->local)) {
+            ok = false;
+            break;
+        }
+        if (workers == 1) {
+            agg_worker(task);
+        } else if (pthread_create(&threads[started], NULL, agg_worker, task) != 0) {
+            agg_destroy(&task->local);
+            ok = false;
+            break;
+        }
+    }
+
+    // The partials are merged into the first one in slice order, which numbers the groups as a
+    // single threaded run would. Only the complete result is merged into `agg`, so a failure
+    // leaves it untouched and the batch can be retried.
+    for (size_t i = 0; i < started; i++) {
+        if (workers > 1) {
+            pthread_join(threads[i], NULL);
+        }
+        ok = ok && tasks[i].ok && (i == 0 || agg_merge(&tasks[0].local, &tasks[i].local));
+        if (i > 0) {
+            agg_destroy(&tasks[i].local);
+        }
+    }
+
+    if (started > 0) {
+        ok = ok && agg_merge(agg, &tasks[0].local);
+        agg_destroy(&tasks[0].local);
+    }
+
+    free(tasks);
+    free(threads);
+    return ok;
+}
+
+bool agg_merge(struct aggregation *agg, const struct aggregation *other)
+{
+    if (!agg || !other || agg->key_size != other->key_size || agg->column_count != other->column_count) {
+        return false;
+    }
+
+    size_t *groups = malloc((other->keys.size ? other->keys.size : 1) * sizeof(size_t));
+    if (!groups) {
+        return false;
+    }
+
+    // Resolve every group before changing any aggregate, so a failure can be undone by
+    // dropping the groups added so far.
+    const size_t group_count = agg->keys.size;
+    for (size_t g = 0; g < other->keys.size; g++) {
+        groups[g] = agg_group_of(agg, AGG_ITEM(&other->keys, g));
+        if (groups[g] == AGG_NONE) {
+            agg_truncate(agg, group_count);
+            free(groups);
+            return false;
+        }
+    }
+
+    size_t *counts = agg->counts.items;
+    const size_t *other_counts = other->counts.items;
+    const struct agg_state *other_states = other->states.items;
+
+    for (size_t g = 0; g < other->keys.size; g++) {
+        counts[groups[g]] += other_counts[g];
+
+        struct agg_state *states = (struct agg_state *)agg->states.items + groups[g] * agg->column_count;
+        const struct agg_state *from = other_states + g * other->column_count;
+        for (size_t c = 0; c < agg->column_count; c++) {
+            states[c].sum += from[c].sum;
+            states[c].min = from[c].min < states[c].min ? from[c].min : states[c].min;
+            states[c].max = from[c].max > states[c].max ? from[c].max : states[c].max;
+        }
+    }
+
+    free(groups);
+    return true;
+}
+
+const struct agg_state *agg_group(const struct aggregation *agg, const size_t group, const void **key, size_t *count)
+{
+    if (!agg || group >= agg->keys.size) {
+        return NULL;
+    }
+
+    if (key) {
+        *key = AGG_ITEM(&agg->keys, group);
+    }
+    if (count) {
+        *count = ((const size_t *)agg->counts.items)[group];
+    }
+
+    return (const struct agg_state *)agg->states.items + group * agg->column_count;
+}
+
+void agg_destroy(struct aggregation *agg)
+{
+    if (!agg) {
+        return;
+    }
+
+    hm_destroy(&agg->groups);
+    vector_deinitialize(&agg->keys);
+    vector_deinitialize(&agg->counts);
+    vector_deinitialize(&agg->states);
+    agg->column_count = 0;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include "../hash_map/hash_map.h"
+#include "../vector/vector.h"
+
+/**
+ * @struct agg_state
+ * @brief  Aggregates of one value column within a group.
+ */
+struct agg_state {
+    /** Sum of the values. */
+    double sum;
+    /** Smallest value. */
+    double min;
+    /** Largest value. */
+    double max;
+};
+
+/**
+ * @struct aggregation
+ * @brief  Group-by over column batches: rows are grouped by key and every value
+ *         column is aggregated per group.
+ *
+ * Groups are numbered densely in the order their key was first seen. The hash map
+ * only maps keys to group numbers, the aggregates live in flat vectors and are
+ * updated in place.
+ */
+struct aggregation {
+    /** Maps each key to its group number. */
+    struct hash_map groups;
+    /** Key of every group. */
+    struct vector keys;
+    /** Number of rows of every group, size_t each. */
+    struct vector counts;
+    /** `column_count` agg_state of every group. */
+    struct vector states;
+    /** Number of value columns. */
+    size_t column_count;
+    /** Key's size. */
+    size_t key_size;
+};
+
+/**
+ * @brief Initializes the aggregation.
+ * 
+ * @param[in]  key_size     Key's size.
+ * @param[in]  column_count Number of value columns, may be 0 to only count rows.
+ * @param[in]  capacity     Expected number of groups.
+ * @param[in]  hash         Hash function for the keys, NULL for hm_hash_bytes.
+ * @param[in]  cmp          Custom comparision function used for comparing keys.
+ * @param[out] agg          Pointer to caller allocated aggregation struct.
+ * 
+ * @return true if successful, false otherwise.
+ */
+bool agg_init(const size_t key_size, const size_t column_count, const size_t capacity, const hash_func hash, const cmp_func cmp, struct aggregation *agg);
+/**
+ * @brief Aggregates a batch of rows.
+ *        Keys are looked up in batches with hm_get_many, then each value column is
+ *        folded into the groups' aggregates in place, one column at a time.
+ * 
+ * @param[in] agg     Pointer to aggregation struct.
+ * @param[in] keys    Key column, `key_size` elements.
+ * @param[in] columns `column_count` value columns of doubles, as long as `keys`.
+ * 
+ * @return true if successful, false otherwise. On failure the rows of the batches before
+ *         the failing one stay aggregated, use agg_update_parallel to retry safely.
+ */
+bool agg_update(struct aggregation *agg, const struct vector *keys, const struct vector *const *columns);
+/**
+ * @brief Aggregates a batch of rows on several threads.
+ *        Each thread aggregates a slice of the rows into its own aggregation,
+ *        which are then merged in slice order and merged into `agg` as a whole.
+ * 
+ * @param[in] agg          Pointer to aggregation struct.
+ * @param[in] keys         Key column, `key_size` elements.
+ * @param[in] columns      `column_count` value columns of doubles, as long as `keys`.
+ * @param[in] thread_count Number of threads, 1 aggregates on the calling thread.
+ * 
+ * @return true if successful, false otherwise, `agg` is left unchanged on failure.
+ */
+bool agg_update_parallel(struct aggregation *agg, const struct vector *keys, const struct vector *const *columns, const size_t thread_count);
+/**
+ * @brief Merges the groups of another aggregation with the same columns into this one.
+ * 
+ * @param[in] agg   Pointer to aggregation struct to merge into.
+ * @param[in] other Pointer to aggregation struct to merge from.
+ * 
+ * @return true if successful, false otherwise, `agg` is left unchanged on failure.
+ */
+bool agg_merge(struct aggregation *agg, const struct aggregation *other);
+/**
+ * @brief Gets the aggregates of a group.
+ * 
+ * @param[in]  agg    Pointer to aggregation struct.
+ * @param[in]  group  Group number, below `agg->keys.size`.
+ * @param[out] key    Optional pointer set to the group's key.
+ * @param[out] count  Optional pointer set to the group's number of rows.
+ * 
+ * @return The group's `column_count` aggregates, NULL if the group does not exist.
+ */
+const struct agg_state *agg_group(const struct aggregation *agg, const size_t group, const void **key, size_t *count);
+/**
+ * @brief Destroys the aggregation.
+ * 
+ * @param[in] agg Pointer to aggregation struct.
+ */
+void agg_destroy(struct aggregation *agg);
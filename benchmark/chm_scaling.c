@@ -0,0 +1,112 @@
+/*
+ * Thread scaling of concurrent_hash_map, 1 to 32 threads.
+ *
+ * Every thread runs the same number of operations on uniformly random keys,
+ * 90% chm_get and 10% chm_insert, so ideal scaling keeps the time constant
+ * and multiplies the throughput by the thread count.
+ *
+ * Build and run from the repository root:
+ *   cc -O2 -pthread benchmark/chm_scaling.c concurrent_hash_map/concurrent_hash_map.c hash_map/hash_map.c -o chm_scaling
+ *   ./chm_scaling [shard_count]
+ */
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../concurrent_hash_map/concurrent_hash_map.h"
+
+#define KEYS (1u << 20)
+#define OPS_PER_THREAD 2000000
+#define MAX_THREADS 32
+
+struct worker {
+    struct concurrent_hash_map *map;
+    uint64_t seed;
+};
+
+static int cmp_u64(const void *a, const void *b)
+{
+    return memcmp(a, b, sizeof(uint64_t));
+}
+
+static uint64_t next_random(uint64_t *state)
+{
+    // xorshift64*
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545f4914f6cdd1dull;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void *run(void *arg)
+{
+    struct worker *worker = arg;
+    uint64_t state = worker->seed;
+    uint64_t value;
+
+    for (int i = 0; i < OPS_PER_THREAD; i++) {
+        const uint64_t r = next_random(&state);
+        const uint64_t key = r % KEYS;
+        if (r >> 60 < 2) {
+            chm_insert(worker->map, &key, &r);
+        } else {
+            chm_get(worker->map, &key, &value);
+        }
+    }
+
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    const size_t shard_count = argc > 1 ? strtoul(argv[1], NULL, 10) : 64;
+    double base = 0.0;
+
+    printf("shards %zu, %u keys, %d ops per thread\n", shard_count, KEYS, OPS_PER_THREAD);
+    printf("%8s %12s %14s %8s\n", "threads", "seconds", "ops/s", "speedup");
+
+    for (size_t threads = 1; threads <= MAX_THREADS; threads *= 2) {
+        struct concurrent_hash_map map;
+        if (!chm_init(sizeof(uint64_t), sizeof(uint64_t), KEYS, shard_count, NULL, cmp_u64, &map)) {
+            fprintf(stderr, "chm_init failed\n");
+            return 1;
+        }
+
+        // Prefill half of the keys, so gets both hit and miss.
+        for (uint64_t key = 0; key < KEYS; key += 2) {
+            chm_insert(&map, &key, &key);
+        }
+
+        pthread_t ids[MAX_THREADS];
+        struct worker workers[MAX_THREADS];
+        const double start = now();
+        for (size_t i = 0; i < threads; i++) {
+            workers[i].map = &map;
+            workers[i].seed = 0x9e3779b97f4a7c15ull * (i + 1);
+            pthread_create(&ids[i], NULL, run, &workers[i]);
+        }
+        for (size_t i = 0; i < threads; i++) {
+            pthread_join(ids[i], NULL);
+        }
+        const double seconds = now() - start;
+
+        const double ops = (double)threads * OPS_PER_THREAD / seconds;
+        if (threads == 1) {
+            base = ops;
+        }
+        printf("%8zu %12.3f %14.0f %8.2f\n", threads, seconds, ops, ops / base);
+
+        chm_destroy(&map);
+    }
+
+    return 0;
+}
@@ -0,0 +1,132 @@
+/*
+ * Linear, quadratic and triangular probing in hash_map compared.
+ *
+ * For every probing scheme, 1M 8-byte keys are inserted, looked up (all hits,
+ * then all misses), and half of them are deleted and inserted again to exercise
+ * tombstones. It runs once with hm_hash_bytes and once with an identity hash on
+ * strided keys, where clustering hurts linear probing the most.
+ *
+ * Build and run from the repository root:
+ *   cc -O2 benchmark/hm_probing.c hash_map/hash_map.c -o hm_probing
+ *   ./hm_probing
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../hash_map/hash_map.h"
+
+#define KEYS (1u << 20)
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+    return memcmp(a, b, sizeof(uint64_t));
+}
+
+static uint64_t hash_identity(const void *key, const size_t size)
+{
+    (void)size;
+    uint64_t value;
+    memcpy(&value, key, sizeof(value));
+    return value;
+}
+
+/** Nanoseconds per operation. */
+static double per_op(const double seconds)
+{
+    return seconds * 1e9 / KEYS;
+}
+
+static void run(const char *name, const enum hm_probing probing, const hash_func hash, const uint64_t *keys, const uint64_t *missing)
+{
+    struct hash_map map;
+    hm_init(sizeof(uint64_t), sizeof(uint64_t), 16, hash, cmp_u64, &map);
+    if (!map.table) {
+        fprintf(stderr, "hm_init failed\n");
+        exit(1);
+    }
+    map.probing = probing;
+
+    double start = now();
+    for (size_t i = 0; i < KEYS; i++) {
+        hm_insert(&map, &keys[i], &i);
+    }
+    const double insert = now() - start;
+
+    size_t found = 0;
+    start = now();
+    for (size_t i = 0; i < KEYS; i++) {
+        found += hm_get(&map, &keys[i]) != NULL;
+    }
+    const double hit = now() - start;
+
+    start = now();
+    for (size_t i = 0; i < KEYS; i++) {
+        found += hm_get(&map, &missing[i]) != NULL;
+    }
+    const double miss = now() - start;
+
+    start = now();
+    for (size_t i = 0; i < KEYS; i += 2) {
+        hm_delete(&map, &keys[i]);
+    }
+    for (size_t i = 0; i < KEYS; i += 2) {
+        hm_insert(&map, &keys[i], &i);
+    }
+    const double churn = now() - start;
+
+    if (found != KEYS || map.size != KEYS) {
+        fprintf(stderr, "%s: wrong result\n", name);
+        exit(1);
+    }
+
+    printf("%-12s %10.1f %10.1f %10.1f %10.1f\n", name, per_op(insert), per_op(hit), per_op(miss), per_op(churn));
+    hm_destroy(&map);
+}
+
+static void run_all(const char *title, const hash_func hash, const uint64_t *keys, const uint64_t *missing)
+{
+    printf("\n%s, ns per key\n", title);
+    printf("%-12s %10s %10s %10s %10s\n", "probing", "insert", "hit", "miss", "churn");
+    run("linear", HM_PROBE_LINEAR, hash, keys, missing);
+    run("quadratic", HM_PROBE_QUADRATIC, hash, keys, missing);
+    run("triangular", HM_PROBE_TRIANGULAR, hash, keys, missing);
+}
+
+int main(void)
+{
+    uint64_t *keys = malloc(KEYS * sizeof(uint64_t));
+    uint64_t *missing = malloc(KEYS * sizeof(uint64_t));
+    if (!keys || !missing) {
+        fprintf(stderr, "allocation failed\n");
+        return 1;
+    }
+
+    // Random odd keys, and even keys that are never inserted.
+    uint64_t state = 0x9e3779b97f4a7c15ull;
+    for (size_t i = 0; i < KEYS; i++) {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        keys[i] = state | 1;
+        missing[i] = state & ~(uint64_t)1;
+    }
+    run_all("random keys, hm_hash_bytes", NULL, keys, missing);
+
+    // Runs of consecutive keys with the identity hash fill contiguous slots.
+    for (size_t i = 0; i < KEYS; i++) {
+        keys[i] = (i / 64) * 1024 + i % 64;
+        missing[i] = keys[i] + 512;
+    }
+    run_all("clustered keys, identity hash", hash_identity, keys, missing);
+
+    free(keys);
+    free(missing);
+    return 0;
+}
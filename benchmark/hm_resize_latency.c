@@ -0,0 +1,88 @@
+/*
+ * Worst case insert latency of hash_map with the Bloom filter enabled.
+ *
+ * Inserts 4M keys into a map starting at 16 slots, once rehashing every resize at
+ * once and once with incremental_resize, and reports the slowest single insert.
+ * With incremental_resize neither the entries nor the filter may be rebuilt in
+ * one go, so its slowest insert has to stay far below the other mode's, which
+ * moves the whole table. The program exits with 1 if it does not.
+ *
+ * Build and run from the repository root:
+ *   cc -O2 benchmark/hm_resize_latency.c hash_map/hash_map.c -o hm_resize_latency
+ *   ./hm_resize_latency
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "../hash_map/hash_map.h"
+
+#define KEYS (4u << 20)
+/** The incremental worst case must be at least this many times lower. */
+#define MIN_RATIO 8.0
+
+static int cmp_u64(const void *a, const void *b)
+{
+    return memcmp(a, b, sizeof(uint64_t));
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/**
+ * @return Slowest insert in seconds.
+ */
+static double run(const bool incremental, double *total)
+{
+    struct hash_map map;
+    hm_init(sizeof(uint64_t), sizeof(uint64_t), 16, NULL, cmp_u64, &map);
+    map.incremental_resize = incremental;
+    if (!hm_enable_filter(&map)) {
+        fprintf(stderr, "hm_enable_filter failed\n");
+        return 0.0;
+    }
+
+    double worst = 0.0;
+    const double begin = now();
+    for (uint64_t key = 0; key < KEYS; key++) {
+        const double start = now();
+        hm_insert(&map, &key, &key);
+        const double elapsed = now() - start;
+        if (elapsed > worst) {
+            worst = elapsed;
+        }
+    }
+    *total = now() - begin;
+
+    for (uint64_t key = 0; key < KEYS; key++) {
+        if (!hm_get(&map, &key)) {
+            fprintf(stderr, "key %llu lost\n", (unsigned long long)key);
+            worst = 0.0;
+            break;
+        }
+    }
+
+    hm_destroy(&map);
+    return worst;
+}
+
+int main(void)
+{
+    double total_at_once, total_incremental;
+    const double at_once = run(false, &total_at_once);
+    const double incremental = run(true, &total_incremental);
+
+    printf("%-12s %14s %14s\n", "resize", "worst insert", "total");
+    printf("%-12s %12.1fus %13.3fs\n", "at once", at_once * 1e6, total_at_once);
+    printf("%-12s %12.1fus %13.3fs\n", "incremental", incremental * 1e6, total_incremental);
+
+    if (at_once == 0.0 || incremental == 0.0 || incremental * MIN_RATIO > at_once) {
+        fprintf(stderr, "incremental resize does not bound the insert latency\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,116 @@
+/*
+ * Speed-up of the parallel algorithms over their single threaded run.
+ *
+ * Times par_transform, par_reduce and par_sort on 16M doubles with pools of 1
+ * thread up to the given maximum, doubling each step. The 1 thread pool runs
+ * every chunk on the caller, so it is the serial baseline.
+ *
+ * Build and run from the repository root:
+ *   cc -O2 -pthread benchmark/par_speedup.c parallel/parallel.c vector/vector.c array/array.c -o par_speedup
+ *   ./par_speedup [max_threads]
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "../parallel/parallel.h"
+
+#define ELEMENTS (16u << 20)
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void polynomial(const void *in, void *out, void *ctx)
+{
+    (void)ctx;
+    const double x = *(const double *)in;
+    *(double *)out = ((3.0 * x + 2.0) * x + 1.0) * x;
+}
+
+static void sum(void *acc, const void *element, void *ctx)
+{
+    (void)ctx;
+    *(double *)acc += *(const double *)element;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    const double x = *(const double *)a;
+    const double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char **argv)
+{
+    const long online = sysconf(_SC_NPROCESSORS_ONLN);
+    const size_t max_threads = argc > 1 ? strtoul(argv[1], NULL, 10) : (online > 0 ? (size_t)online : 1);
+
+    double *in = malloc(ELEMENTS * sizeof(double));
+    double *out = malloc(ELEMENTS * sizeof(double));
+    double *keys = malloc(ELEMENTS * sizeof(double));
+    if (!in || !out || !keys) {
+        fprintf(stderr, "allocation failed\n");
+        return 1;
+    }
+
+    uint64_t state = 0x9e3779b97f4a7c15ull;
+    for (size_t i = 0; i < ELEMENTS; i++) {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        in[i] = (double)(state >> 11) / (double)(1ull << 53);
+    }
+
+    // Fault every page in up front, so the first run does not pay for it.
+    memset(out, 0, ELEMENTS * sizeof(double));
+    memset(keys, 0, ELEMENTS * sizeof(double));
+
+    const struct par_span in_span = {in, ELEMENTS, sizeof(double)};
+    const struct par_span out_span = {out, ELEMENTS, sizeof(double)};
+    const struct par_span keys_span = {keys, ELEMENTS, sizeof(double)};
+    const double zero = 0.0;
+    double base[3] = {0.0, 0.0, 0.0};
+
+    printf("%u doubles, up to %zu threads\n", ELEMENTS, max_threads);
+    printf("%8s %12s %8s %12s %8s %12s %8s\n", "threads", "transform", "speedup", "reduce", "speedup", "sort", "speedup");
+
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        struct par_pool pool;
+        if (!par_pool_init(threads, &pool)) {
+            fprintf(stderr, "par_pool_init failed\n");
+            return 1;
+        }
+
+        double seconds[3];
+        double start = now();
+        par_transform(&pool, in_span, out_span, polynomial, NULL);
+        seconds[0] = now() - start;
+
+        double total;
+        start = now();
+        par_reduce(&pool, out_span, &zero, sum, NULL, &total);
+        seconds[1] = now() - start;
+
+        memcpy(keys, in, ELEMENTS * sizeof(double));
+        start = now();
+        par_sort(&pool, keys_span, cmp_double);
+        seconds[2] = now() - start;
+
+        if (threads == 1) {
+            memcpy(base, seconds, sizeof(base));
+        }
+        printf("%8zu %11.3fs %8.2f %11.3fs %8.2f %11.3fs %8.2f\n", threads,
+            seconds[0], base[0] / seconds[0], seconds[1], base[1] / seconds[1], seconds[2], base[2] / seconds[2]);
+
+        par_pool_destroy(&pool);
+    }
+
+    free(in);
+    free(out);
+    free(keys);
+    return 0;
+}
@@ -0,0 +1,217 @@
+#include "cache.h"
+
+#include <string.h>
+
+#define CACHE_SLOT(cache, index) ((struct cache_slot *)((char *)(cache)->slots + ((index) * (cache)->slot_size)))
+#define CACHE_KEY(cache, slot) ((void *)((char *)(slot) + (cache)->key_offset))
+#define CACHE_VALUE(cache, slot) ((void *)((char *)(slot) + (cache)->value_offset))
+#define CACHE_ALIGN_UP(size) (((size) + 7) & ~(size_t)7)
+
+bool cache_init(const size_t key_size, const size_t value_size, const size_t capacity, const enum cache_policy policy, const hash_func hash, const cmp_func cmp, const cache_evict_func on_evict, void *ctx, struct cache *cache)
+{
+    if (key_size == 0 || value_size == 0 || capacity == 0 || !cmp || !cache) {
+        return false;
+    }
+
+    cache->key_offset = CACHE_ALIGN_UP(sizeof(struct cache_slot));
+    cache->value_offset = cache->key_offset + CACHE_ALIGN_UP(key_size);
+    cache->slot_size = cache->value_offset + CACHE_ALIGN_UP(value_size);
+
+    cache->slots = malloc(capacity * cache->slot_size);
+    if (!cache->slots) {
+        return false;
+    }
+
+    // Sized so the index never resizes, it holds at most `capacity` keys.
+    hm_init(key_size, sizeof(size_t), capacity * 2, hash, cmp, &cache->index);
+    if (!cache->index.table) {
+        free(cache->slots);
+        cache->slots = NULL;
+        return false;
+    }
+
+    for (size_t i = 0; i < capacity; i++) {
+        CACHE_SLOT(cache, i)->next = i + 1 < capacity ? i + 1 : CACHE_NONE;
+    }
+
+    cache->key_size = key_size;
+    cache->value_size = value_size;
+    cache->head = CACHE_NONE;
+    cache->tail = CACHE_NONE;
+    cache->free_list = 0;
+    cache->hand = CACHE_NONE;
+    cache->size = 0;
+    cache->capacity = capacity;
+    cache->policy = policy;
+    cache->on_evict = on_evict;
+    cache->ctx = ctx;
+    return true;
+}
+
+/**
+ * @brief Unlinks a slot from the recency list.
+ */
+static void cache_unlink(struct cache *cache, const size_t index)
+{
+    struct cache_slot *slot = CACHE_SLOT(cache, index);
+
+    if (slot->prev != CACHE_NONE) {
+        CACHE_SLOT(cache, slot->prev)->next = slot->next;
+    } else {
+        cache->head = slot->next;
+    }
+
+    if (slot->next != CACHE_NONE) {
+        CACHE_SLOT(cache, slot->next)->prev = slot->prev;
+    } else {
+        cache->tail = slot->prev;
+    }
+}
+
+/**
+ * @brief Links a slot in front of the recency list.
+ */
+static void cache_push_front(struct cache *cache, const size_t index)
+{
+    struct cache_slot *slot = CACHE_SLOT(cache, index);
+
+    slot->prev = CACHE_NONE;
+    slot->next = cache->head;
+    if (cache->head != CACHE_NONE) {
+        CACHE_SLOT(cache, cache->head)->prev = index;
+    } else {
+        cache->tail = index;
+    }
+    cache->head = index;
+}
+
+/**
+ * @brief Unlinks a slot, drops its key from the index and puts it on the free list.
+ */
+static void cache_release(struct cache *cache, const size_t index)
+{
+    struct cache_slot *slot = CACHE_SLOT(cache, index);
+
+    if (cache->hand == index) {
+        cache->hand = slot->prev;
+    }
+    cache_unlink(cache, index);
+    hm_delete(&cache->index, CACHE_KEY(cache, slot));
+
+    slot->next = cache->free_list;
+    cache->free_list = index;
+    cache->size--;
+}
+
+/**
+ * @brief Picks the entry to evict according to the policy.
+ *
+ * SIEVE moves the hand from the tail towards the head, clearing visited bits
+ * on the way, and wraps around to the tail. It stops on the first unvisited
+ * entry, which always exists after at most one full sweep.
+ *
+ * @return Index of the victim slot.
+ */
+static size_t cache_victim(struct cache *cache)
+{
+    if (cache->policy == CACHE_LRU) {
+        return cache->tail;
+    }
+
+    size_t index = cache->hand != CACHE_NONE ? cache->hand : cache->tail;
+    for (;;) {
+        struct cache_slot *slot = CACHE_SLOT(cache, index);
+        if (!slot->visited) {
+            cache->hand = index;
+            return index;
+        }
+        slot->visited = false;
+        index = slot->prev != CACHE_NONE ? slot->prev : cache->tail;
+    }
+}
+
+void *cache_get(struct cache *cache, const void *key)
+{
+    if (!cache || !cache->slots || !key) {
+        return NULL;
+    }
+
+    const size_t *index = hm_get(&cache->index, key);
+    if (!index) {
+        return NULL;
+    }
+
+    const size_t found = *index;
+    struct cache_slot *slot = CACHE_SLOT(cache, found);
+    if (cache->policy == CACHE_LRU) {
+        if (cache->head != found) {
+            cache_unlink(cache, found);
+            cache_push_front(cache, found);
+        }
+    } else {
+        slot->visited = true;
+    }
+    return CACHE_VALUE(cache, slot);
+}
+
+void cache_put(struct cache *cache, const void *key, const void *value)
+{
+    if (!cache || !cache->slots || !key || !value) {
+        return;
+    }
+
+    void *existing = cache_get(cache, key);
+    if (existing) {
+        memcpy(existing, value, cache->value_size);
+        return;
+    }
+
+    if (cache->free_list == CACHE_NONE) {
+        const size_t victim = cache_victim(cache);
+        struct cache_slot *slot = CACHE_SLOT(cache, victim);
+        if (cache->on_evict) {
+            cache->on_evict(CACHE_KEY(cache, slot), CACHE_VALUE(cache, slot), cache->ctx);
+        }
+        cache_release(cache, victim);
+    }
+
+    const size_t index = cache->free_list;
+    struct cache_slot *slot = CACHE_SLOT(cache, index);
+    cache->free_list = slot->next;
+
+    memcpy(CACHE_KEY(cache, slot), key, cache->key_size);
+    memcpy(CACHE_VALUE(cache, slot), value, cache->value_size);
+    slot->visited = false;
+    cache_push_front(cache, index);
+    hm_insert(&cache->index, key, &index);
+    cache->size++;
+}
+
+void cache_remove(struct cache *cache, const void *key)
+{
+    if (!cache || !cache->slots || !key) {
+        return;
+    }
+
+    const size_t *index = hm_get(&cache->index, key);
+    if (index) {
+        cache_release(cache, *index);
+    }
+}
+
+void cache_destroy(struct cache *cache)
+{
+    if (!cache) {
+        return;
+    }
+
+    hm_destroy(&cache->index);
+    free(cache->slots);
+    cache->slots = NULL;
+    cache->head = CACHE_NONE;
+    cache->tail = CACHE_NONE;
+    cache->free_list = CACHE_NONE;
+    cache->hand = CACHE_NONE;
+    cache->size = 0;
+    cache->capacity = 0;
+}
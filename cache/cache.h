@@ -0,0 +1,140 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include "../hash_map/hash_map.h"
+
+/**
+ * @typedef cache_evict_func
+ * @brief   Called with an entry the cache is about to drop to make room.
+ * 
+ * @param[in] key   Key of the evicted entry.
+ * @param[in] value Value of the evicted entry, may be modified or released.
+ * @param[in] ctx   Context given to cache_init.
+ */
+typedef void (*cache_evict_func)(const void *key, void *value, void *ctx);
+
+/**
+ * @enum  cache_policy
+ * @brief Which entry to drop once the cache is full.
+ */
+enum cache_policy {
+    /** Least recently used, every hit moves the entry to the front. */
+    CACHE_LRU,
+    /**
+     * SIEVE, a CLOCK variant: hits only set a visited bit and a hand sweeps from
+     * the oldest entry, sparing visited ones once. Cheaper hits, scan resistant.
+     */
+    CACHE_SIEVE
+};
+
+/**
+ * @struct cache_slot
+ * @brief  Header of a slot, the key and value follow it inline.
+ *
+ * The list links are indices into the slot array, so entries never move and
+ * need no allocation of their own.
+ */
+struct cache_slot {
+    /** Slot towards the newest entry, CACHE_NONE at the head. */
+    size_t prev;
+    /** Slot towards the oldest entry, CACHE_NONE at the tail. Links free slots too. */
+    size_t next;
+    /** Hit since the SIEVE hand last passed. */
+    bool visited;
+};
+
+/** Marks the end of a list. */
+#define CACHE_NONE ((size_t)-1)
+
+/**
+ * @struct cache
+ * @brief  Bounded key-value cache with O(1) get, put and eviction.
+ *
+ * The recency links live in a separate slot array rather than in the index's
+ * entries. hash_map moves entries on backward shift deletion, tombstone rehash
+ * and resize, which would leave links to them dangling, while slots never move,
+ * so the value pointer cache_get returns stays valid too. The cost is the key
+ * stored in both the index and its slot, and a hit touching two cache lines.
+ */
+struct cache {
+    /** Maps each key to its slot. */
+    struct hash_map index;
+    /** Fixed array of `capacity` slots. */
+    void *slots;
+    /** Size of a single slot (header, key and value). */
+    size_t slot_size;
+    /** Offset of the key inside a slot. */
+    size_t key_offset;
+    /** Offset of the value inside a slot. */
+    size_t value_offset;
+    /** Key's size. */
+    size_t key_size;
+    /** Value's size. */
+    size_t value_size;
+    /** Newest entry. */
+    size_t head;
+    /** Oldest entry. */
+    size_t tail;
+    /** First unused slot. */
+    size_t free_list;
+    /** Current position of the SIEVE hand. */
+    size_t hand;
+    /** Current number of entries. */
+    size_t size;
+    /** Maximum number of entries. */
+    size_t capacity;
+    /** Eviction policy. */
+    enum cache_policy policy;
+    /** Optional callback for evicted entries. */
+    cache_evict_func on_evict;
+    /** Context passed to `on_evict`. */
+    void *ctx;
+};
+
+/**
+ * @brief Initializes the cache.
+ * 
+ * @param[in]  key_size   Key's size.
+ * @param[in]  value_size Value's size.
+ * @param[in]  capacity   Maximum number of entries.
+ * @param[in]  policy     Eviction policy.
+ * @param[in]  hash       Hash function for the keys, NULL for hm_hash_bytes.
+ * @param[in]  cmp        Custom comparision function used for comparing keys.
+ * @param[in]  on_evict   Optional callback for evicted entries.
+ * @param[in]  ctx        Context passed to `on_evict`.
+ * @param[out] cache      Pointer to caller allocated cache struct.
+ * 
+ * @return true if successful, false otherwise.
+ */
+bool cache_init(const size_t key_size, const size_t value_size, const size_t capacity, const enum cache_policy policy, const hash_func hash, const cmp_func cmp, const cache_evict_func on_evict, void *ctx, struct cache *cache);
+/**
+ * @brief Gets value from its key and records the hit.
+ * 
+ * @param[in] cache Pointer to cache struct.
+ * @param[in] key   Key to search.
+ * 
+ * @return Pointer to the cached value if found, NULL otherwise. Valid until the entry is evicted or removed.
+ */
+void *cache_get(struct cache *cache, const void *key);
+/**
+ * @brief Inserts or updates an entry, evicting one first if the cache is full.
+ * 
+ * @param[in] cache Pointer to cache struct.
+ * @param[in] key   Key to insert.
+ * @param[in] value Value to insert.
+ */
+void cache_put(struct cache *cache, const void *key, const void *value);
+/**
+ * @brief Removes an entry without calling the eviction callback.
+ * 
+ * @param[in] cache Pointer to cache struct.
+ * @param[in] key   Key to remove.
+ */
+void cache_remove(struct cache *cache, const void *key);
+/**
+ * @brief Destroys the cache without calling the eviction callback.
+ * 
+ * @param[in] cache Pointer to cache struct.
+ */
+void cache_destroy(struct cache *cache);
@@ -0,0 +1,147 @@
+#include "concurrent_hash_map.h"
+
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * @brief Picks the shard of a hash.
+ *
+ * The hash is scrambled with a Fibonacci multiply and the top bits are used, so the
+ * choice is independent of the low bits each shard's hash map probes with.
+ * 
+ * @param[in] map  Pointer to concurrent_hash_map struct.
+ * @param[in] hash Hash of the key, passed on to the shard's hm_*_hashed call.
+ * 
+ * @return Pointer to the shard.
+ */
+static struct chm_shard *chm_shard_of(const struct concurrent_hash_map *map, const uint64_t hash)
+{
+    if (map->shard_bits == 0) {
+        return map->shards;
+    }
+
+    return &map->shards[(hash * 0x9e3779b97f4a7c15ull) >> (64 - map->shard_bits)];
+}
+
+bool chm_init(const size_t key_size, const size_t value_size, const size_t capacity, const size_t shard_count, const hash_func hash, const cmp_func cmp, struct concurrent_hash_map *map)
+{
+    if (key_size == 0 || value_size == 0 || capacity == 0 || shard_count == 0 || !cmp || !map) {
+        return false;
+    }
+
+    unsigned bits = 0;
+    while (((size_t)1 << bits) < shard_count) {
+        bits++;
+    }
+    const size_t count = (size_t)1 << bits;
+
+    map->shards = aligned_alloc(_Alignof(struct chm_shard), count * sizeof(struct chm_shard));
+    if (!map->shards) {
+        return false;
+    }
+
+    const size_t shard_capacity = capacity / count ? capacity / count : 1;
+
+    for (size_t i = 0; i < count; i++) {
+        struct chm_shard *shard = &map->shards[i];
+        hm_init(key_size, value_size, shard_capacity, hash, cmp, &shard->map);
+
+        const bool ok = shard->map.table && pthread_rwlock_init(&shard->lock, NULL) == 0;
+        if (!ok) {
+            // Only this shard's map may be set up, the earlier shards are complete.
+            hm_destroy(&shard->map);
+            map->shard_count = i;
+            chm_destroy(map);
+            return false;
+        }
+    }
+
+    map->shard_count = count;
+    map->shard_bits = bits;
+    map->key_size = key_size;
+    map->value_size = value_size;
+    map->hash = hash ? hash : hm_hash_bytes;
+
+    return true;
+}
+
+bool chm_get(struct concurrent_hash_map *map, const void *key, void *value)
+{
+    if (!map || !key || !value) {
+        return false;
+    }
+
+    const uint64_t hash = map->hash(key, map->key_size);
+    struct chm_shard *shard = chm_shard_of(map, hash);
+
+    pthread_rwlock_rdlock(&shard->lock);
+    const void *found = hm_get_hashed(&shard->map, key, hash);
+    if (found) {
+        memcpy(value, found, map->value_size);
+    }
+    pthread_rwlock_unlock(&shard->lock);
+
+    return found != NULL;
+}
+
+void chm_insert(struct concurrent_hash_map *map, const void *key, const void *value)
+{
+    if (!map || !key || !value) {
+        return;
+    }
+
+    const uint64_t hash = map->hash(key, map->key_size);
+    struct chm_shard *shard = chm_shard_of(map, hash);
+
+    pthread_rwlock_wrlock(&shard->lock);
+    hm_insert_hashed(&shard->map, key, value, hash);
+    pthread_rwlock_unlock(&shard->lock);
+}
+
+void chm_delete(struct concurrent_hash_map *map, const void *key)
+{
+    if (!map || !key) {
+        return;
+    }
+
+    const uint64_t hash = map->hash(key, map->key_size);
+    struct chm_shard *shard = chm_shard_of(map, hash);
+
+    pthread_rwlock_wrlock(&shard->lock);
+    hm_delete_hashed(&shard->map, key, hash);
+    pthread_rwlock_unlock(&shard->lock);
+}
+
+size_t chm_size(struct concurrent_hash_map *map)
+{
+    if (!map) {
+        return 0;
+    }
+
+    size_t size = 0;
+    for (size_t i = 0; i < map->shard_count; i++) {
+        pthread_rwlock_rdlock(&map->shards[i].lock);
+        size += map->shards[i].map.size;
+        pthread_rwlock_unlock(&map->shards[i].lock);
+    }
+
+    return size;
+}
+
+void chm_destroy(struct concurrent_hash_map *map)
+{
+    if (!map) {
+        return;
+    }
+
+    for (size_t i = 0; i < map->shard_count; i++) {
+        pthread_rwlock_destroy(&map->shards[i].lock);
+        hm_destroy(&map->shards[i].map);
+    }
+
+    free(map->shards);
+    map->shards = NULL;
+    map->shard_count = 0;
+    map->shard_bits = 0;
+    map->hash = NULL;
+}
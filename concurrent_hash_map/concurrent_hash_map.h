@@ -0,0 +1,93 @@
+#pragma once
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "../hash_map/hash_map.h"
+
+/**
+ * @struct chm_shard
+ * @brief  Independently locked part of the concurrent hash map.
+ */
+struct chm_shard {
+    /** Reader-writer lock guarding the shard, aligned so shards never share a cache line. */
+    _Alignas(64) pthread_rwlock_t lock;
+    /** Hash map holding the shard's keys, resizes on its own. */
+    struct hash_map map;
+};
+
+/**
+ * @struct concurrent_hash_map
+ * @brief  Thread-safe hash map, partitioning the keys over independently locked shards.
+ *
+ * Gets on different shards never contend and gets on the same shard share a read lock.
+ */
+struct concurrent_hash_map {
+    /** Array of shards. */
+    struct chm_shard *shards;
+    /** Number of shards, a power of two. */
+    size_t shard_count;
+    /** log2 of shard_count, selects the shard from the top bits of the hash. */
+    unsigned shard_bits;
+    /** Key's size. */
+    size_t key_size;
+    /** Value's size. */
+    size_t value_size;
+    /** Hash function for the keys. */
+    hash_func hash;
+};
+
+/**
+ * @brief Initializes the concurrent hash map. Not thread-safe.
+ * 
+ * @param[in]  key_size    Key's size.
+ * @param[in]  value_size  Value's size.
+ * @param[in]  capacity    Initial capacity, spread over the shards.
+ * @param[in]  shard_count Number of shards, rounded up to a power of two.
+ * @param[in]  hash        Hash function for the keys, NULL for hm_hash_bytes.
+ * @param[in]  cmp         Custom comparision function used for comparing keys.
+ * @param[out] map         Pointer to caller allocated concurrent_hash_map struct.
+ * 
+ * @return true if successful, false otherwise.
+ */
+bool chm_init(const size_t key_size, const size_t value_size, const size_t capacity, const size_t shard_count, const hash_func hash, const cmp_func cmp, struct concurrent_hash_map *map);
+/**
+ * @brief Gets value from its key.
+ *        The value is copied out under the shard's read lock, since it may move once the lock is released.
+ * 
+ * @param[in]  map   Pointer to concurrent_hash_map struct.
+ * @param[in]  key   Key to search.
+ * @param[out] value Pointer to caller allocated buffer of `value_size` bytes.
+ * 
+ * @return true if found, false otherwise.
+ */
+bool chm_get(struct concurrent_hash_map *map, const void *key, void *value);
+/**
+ * @brief Inserts a key into the concurrent hash map.
+ * 
+ * @param[in] map   Pointer to concurrent_hash_map struct.
+ * @param[in] key   Key to insert.
+ * @param[in] value Value to insert.
+ */
+void chm_insert(struct concurrent_hash_map *map, const void *key, const void *value);
+/**
+ * @brief Deletes an entry in the concurrent hash map.
+ * 
+ * @param[in] map Pointer to concurrent_hash_map struct.
+ * @param[in] key Key to delete.
+ */
+void chm_delete(struct concurrent_hash_map *map, const void *key);
+/**
+ * @brief Counts the entries of every shard. Only exact if no writer is running.
+ * 
+ * @param[in] map Pointer to concurrent_hash_map struct.
+ * 
+ * @return Number of entries.
+ */
+size_t chm_size(struct concurrent_hash_map *map);
+/**
+ * @brief Destroys the concurrent hash map. Not thread-safe.
+ * 
+ * @param[in] map Pointer to concurrent_hash_map struct.
+ */
+void chm_destroy(struct concurrent_hash_map *map);
@@ -0,0 +1,446 @@
+#include "hash_join.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
+/** Probe rows whose keys are looked up together. */
+#define HJ_BATCH 16
+/** End of a chain of build rows. */
+#define HJ_NONE ((size_t)-1)
+/** Build rows per partition aimed for by hj_join_partitioned, a table of them fits in L2. */
+#define HJ_PARTITION_ROWS 4096
+/** Upper limit of partition bits, keeps a partition index inside a uint32_t and the bounds small. */
+#define HJ_MAX_PARTITION_BITS 14
+
+#define HJ_KEY(vec, index, offset) ((const char *)(vec)->items + ((index) * (vec)->e_size) + (offset))
+
+/**
+ * @brief Sets up an empty table over a build side.
+ *
+ * @param[in] next Chain array to use, NULL to allocate one owned by the join.
+ *
+ * @return true if successful, false otherwise.
+ */
+static bool hj_init(const struct vector *build, const size_t key_offset, const size_t key_size, const size_t capacity, const hash_func hash, const cmp_func cmp, size_t *next, struct hash_join *join)
+{
+    hm_init(key_size, sizeof(size_t), capacity ? capacity : 1, hash, cmp, &join->heads);
+    if (!join->heads.table) {
+        return false;
+    }
+
+    join->next = next ? next : malloc((build->size ? build->size : 1) * sizeof(size_t));
+    if (!join->next) {
+        hm_destroy(&join->heads);
+        return false;
+    }
+
+    join->build = build;
+    join->key_offset = key_offset;
+    join->key_size = key_size;
+    return true;
+}
+
+/**
+ * @brief Adds build rows to the table.
+ *
+ * Rows are added last to first, so every chain lists its rows in ascending order.
+ *
+ * @param[in] join  Pointer to hash_join struct.
+ * @param[in] rows  Indices of the rows, NULL for 0 to `count - 1`.
+ * @param[in] count Number of rows.
+ *
+ * @return true if successful, false if the table could not grow.
+ */
+static bool hj_build_rows(struct hash_join *join, const size_t *rows, const size_t count)
+{
+    for (size_t i = count; i-- > 0;) {
+        const size_t row = rows ? rows[i] : i;
+        const void *key = HJ_KEY(join->build, row, join->key_offset);
+
+        bool inserted;
+        size_t *head = hm_get_or_insert(&join->heads, key, &inserted);
+        if (!head) {
+            return false;
+        }
+        join->next[row] = inserted ? HJ_NONE : *head;
+        *head = row;
+    }
+
+    return true;
+}
+
+bool hj_build(const struct vector *build, const size_t key_offset, const size_t key_size, const hash_func hash, const cmp_func cmp, struct hash_join *join)
+{
+    if (!build || key_size == 0 || key_offset + key_size > build->e_size || !cmp || !join) {
+        return false;
+    }
+
+    if (!hj_init(build, key_offset, key_size, build->size * 2, hash, cmp, NULL, join)) {
+        return false;
+    }
+
+    if (!hj_build_rows(join, NULL, build->size)) {
+        hj_destroy(join);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Probes the table with some probe rows.
+ *
+ * @param[in]  join       Pointer to hash_join struct.
+ * @param[in]  probe      Probe side rows.
+ * @param[in]  key_offset Offset of the key inside a probe row.
+ * @param[in]  rows       Indices of the rows, NULL for 0 to `count - 1`.
+ * @param[in]  count      Number of rows.
+ * @param[in]  keys       Scratch buffer for HJ_BATCH keys.
+ * @param[out] pairs      Vector the matches are appended to.
+ *
+ * @return true if successful, false otherwise.
+ */
+static bool hj_probe_rows(const struct hash_join *join, const struct vector *probe, const size_t key_offset, const size_t *rows, const size_t count, char *keys, struct vector *pairs)
+{
+    void *heads[HJ_BATCH];
+
+    for (size_t start = 0; start < count; start += HJ_BATCH) {
+        const size_t n = count - start < HJ_BATCH ? count - start : HJ_BATCH;
+
+        // hm_get_many wants the keys packed, gather them out of the rows.
+        for (size_t i = 0; i < n; i++) {
+            const size_t row = rows ? rows[start + i] : start + i;
+            memcpy(keys + i * join->key_size, HJ_KEY(probe, row, key_offset), join->key_size);
+        }
+
+        hm_get_many(&join->heads, keys, n, heads);
+
+        for (size_t i = 0; i < n; i++) {
+            if (!heads[i]) {
+                continue;
+            }
+
+            struct hj_pair pair = {0, rows ? rows[start + i] : start + i};
+            for (pair.build = *(const size_t *)heads[i]; pair.build != HJ_NONE; pair.build = join->next[pair.build]) {
+                if (!vector_push_back(pairs, &pair)) {
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+bool hj_probe(const struct hash_join *join, const struct vector *probe, const size_t key_offset, struct vector *pairs)
+{
+    if (!join || !join->next || !probe || key_offset + join->key_size > probe->e_size || !pairs || pairs->e_size != sizeof(struct hj_pair)) {
+        return false;
+    }
+
+    char *keys = malloc(HJ_BATCH * join->key_size);
+    if (!keys) {
+        return false;
+    }
+
+    const bool ok = hj_probe_rows(join, probe, key_offset, NULL, probe->size, keys, pairs);
+    free(keys);
+    return ok;
+}
+
+void hj_destroy(struct hash_join *join)
+{
+    if (!join) {
+        return;
+    }
+
+    hm_destroy(&join->heads);
+    free(join->next);
+    join->next = NULL;
+    join->build = NULL;
+}
+
+/**
+ * @struct hj_side
+ * @brief  One side of a partitioned join, its rows ordered by partition.
+ */
+struct hj_side {
+    /** Rows of the side. */
+    const struct vector *rows;
+    /** Offset of the key inside a row. */
+    size_t key_offset;
+    /** Row indices, partition by partition. */
+    size_t *order;
+    /** Start of every partition in `order`, plus the end. */
+    size_t *bounds;
+};
+
+/**
+ * @struct hj_partition_task
+ * @brief  Range of rows partitioned by one thread.
+ */
+struct hj_partition_task {
+    /** Side being partitioned. */
+    struct hj_side *side;
+    /** Key's size. */
+    size_t key_size;
+    /** Hash function for the keys. */
+    hash_func hash;
+    /** Number of top hash bits used. */
+    unsigned bits;
+    /** Partition of every row of the side, shared by all threads. */
+    uint32_t *partition_of;
+    /** First row. */
+    size_t first;
+    /** End of the rows. */
+    size_t last;
+    /** Row count of every partition in the range, then the scatter cursor of every partition. */
+    size_t *counts;
+    /** Whether the current pass runs on its own thread. */
+    bool threaded;
+};
+
+/**
+ * @brief Hashes the rows of a range and counts them per partition.
+ */
+static void *hj_histogram(void *arg)
+{
+    struct hj_partition_task *task = arg;
+
+    for (size_t i = task->first; i < task->last; i++) {
+        const uint64_t h = task->hash(HJ_KEY(task->side->rows, i, task->side->key_offset), task->key_size);
+        // Top bits, the per partition tables probe with the low ones.
+        task->partition_of[i] = task->bits ? (uint32_t)(h >> (64 - task->bits)) : 0;
+        task->counts[task->partition_of[i]]++;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Writes the rows of a range to their place in the order.
+ */
+static void *hj_scatter(void *arg)
+{
+    struct hj_partition_task *task = arg;
+
+    for (size_t i = task->first; i < task->last; i++) {
+        task->side->order[task->counts[task->partition_of[i]]++] = i;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Runs a pass over every partition task, one thread each.
+ *
+ * A task whose thread cannot be started runs on the calling thread instead.
+ */
+static void hj_partition_pass(struct hj_partition_task *tasks, pthread_t *threads, const size_t count, void *(*pass)(void *))
+{
+    for (size_t t = 1; t < count; t++) {
+        tasks[t].threaded = pthread_create(&threads[t], NULL, pass, &tasks[t]) == 0;
+        if (!tasks[t].threaded) {
+            pass(&tasks[t]);
+        }
+    }
+    pass(&tasks[0]);
+
+    for (size_t t = 1; t < count; t++) {
+        if (tasks[t].threaded) {
+            pthread_join(threads[t], NULL);
+        }
+    }
+}
+
+/**
+ * @brief Orders the rows of a side by partition with a counting sort on the hash's top bits.
+ *
+ * Hashing and scattering are split over contiguous row ranges, one per thread. Every
+ * range gets its own cursors, laid out range after range inside each partition, so
+ * rows keep their relative order inside a partition.
+ *
+ * @return true if successful, false otherwise.
+ */
+static bool hj_partition(struct hj_side *side, const size_t key_size, const hash_func hash, const unsigned bits, const size_t thread_count)
+{
+    const size_t partitions = (size_t)1 << bits;
+    const size_t count = side->rows->size;
+    // Not worth a thread below a partition's worth of rows.
+    const size_t max_threads = count / HJ_PARTITION_ROWS ? count / HJ_PARTITION_ROWS : 1;
+    const size_t threads_used = thread_count < max_threads ? thread_count : max_threads;
+
+    side->order = malloc((count ? count : 1) * sizeof(size_t));
+    side->bounds = malloc((partitions + 1) * sizeof(size_t));
+    uint32_t *partition_of = malloc((count ? count : 1) * sizeof(uint32_t));
+    size_t *counts = calloc(threads_used * partitions, sizeof(size_t));
+    struct hj_partition_task *tasks = malloc(threads_used * sizeof(struct hj_partition_task));
+    pthread_t *threads = malloc(threads_used * sizeof(pthread_t));
+    const bool ok = side->order && side->bounds && partition_of && counts && tasks && threads;
+
+    if (ok) {
+        for (size_t t = 0; t < threads_used; t++) {
+            tasks[t] = (struct hj_partition_task){side, key_size, hash, bits, partition_of,
+                count * t / threads_used, count * (t + 1) / threads_used, counts + t * partitions, false};
+        }
+
+        hj_partition_pass(tasks, threads, threads_used, hj_histogram);
+
+        // Turn the per range counts into cursors, partition by partition.
+        size_t cursor = 0;
+        for (size_t p = 0; p < partitions; p++) {
+            side->bounds[p] = cursor;
+            for (size_t t = 0; t < threads_used; t++) {
+                const size_t n = counts[t * partitions + p];
+                counts[t * partitions + p] = cursor;
+                cursor += n;
+            }
+        }
+        side->bounds[partitions] = cursor;
+
+        hj_partition_pass(tasks, threads, threads_used, hj_scatter);
+    }
+
+    free(partition_of);
+    free(counts);
+    free(tasks);
+    free(threads);
+    return ok;
+}
+
+/**
+ * @struct hj_task
+ * @brief  Range of partitions joined by one thread.
+ */
+struct hj_task {
+    /** Build side. */
+    const struct hj_side *build;
+    /** Probe side. */
+    const struct hj_side *probe;
+    /** Chain array shared by all partitions, each writes only its own rows. */
+    size_t *next;
+    /** Key's size. */
+    size_t key_size;
+    /** Hash function for the keys. */
+    hash_func hash;
+    /** Custom comparasion function for comparing keys. */
+    cmp_func cmp;
+    /** First partition. */
+    size_t first;
+    /** End of the partitions. */
+    size_t last;
+    /** Matches found by the thread. */
+    struct vector pairs;
+    /** Whether all partitions were joined. */
+    bool ok;
+};
+
+static void *hj_worker(void *arg)
+{
+    struct hj_task *task = arg;
+    const struct hj_side *build = task->build;
+    const struct hj_side *probe = task->probe;
+
+    char *keys = malloc(HJ_BATCH * task->key_size);
+    task->ok = keys != NULL;
+
+    for (size_t p = task->first; task->ok && p < task->last; p++) {
+        const size_t build_count = build->bounds[p + 1] - build->bounds[p];
+        const size_t probe_count = probe->bounds[p + 1] - probe->bounds[p];
+        if (build_count == 0 || probe_count == 0) {
+            continue;
+        }
+
+        struct hash_join join;
+        if (!hj_init(build->rows, build->key_offset, task->key_size, build_count * 2, task->hash, task->cmp, task->next, &join)) {
+            task->ok = false;
+            break;
+        }
+
+        task->ok = hj_build_rows(&join, build->order + build->bounds[p], build_count)
+            && hj_probe_rows(&join, probe->rows, probe->key_offset, probe->order + probe->bounds[p], probe_count, keys, &task->pairs);
+        // `next` is shared, only the table belongs to the partition.
+        hm_destroy(&join.heads);
+    }
+
+    free(keys);
+    return NULL;
+}
+
+bool hj_join_partitioned(const struct vector *build, const size_t build_key_offset, const struct vector *probe, const size_t probe_key_offset, const size_t key_size, const hash_func hash, const cmp_func cmp, const unsigned partition_bits, const size_t thread_count, struct vector *pairs)
+{
+    if (!build || !probe || key_size == 0 || build_key_offset + key_size > build->e_size || probe_key_offset + key_size > probe->e_size
+        || !cmp || thread_count == 0 || !pairs || pairs->e_size != sizeof(struct hj_pair)) {
+        return false;
+    }
+
+    if (partition_bits > HJ_MAX_PARTITION_BITS) {
+        return false;
+    }
+
+    unsigned bits = partition_bits;
+    if (bits == 0) {
+        while (bits < HJ_MAX_PARTITION_BITS && (build->size >> bits) > HJ_PARTITION_ROWS) {
+            bits++;
+        }
+    }
+
+    const hash_func hash_fn = hash ? hash : hm_hash_bytes;
+    const size_t partitions = (size_t)1 << bits;
+    const size_t threads_used = thread_count < partitions ? thread_count : partitions;
+
+    struct hj_side build_side = {build, build_key_offset, NULL, NULL};
+    struct hj_side probe_side = {probe, probe_key_offset, NULL, NULL};
+    size_t *next = malloc((build->size ? build->size : 1) * sizeof(size_t));
+    struct hj_task *tasks = calloc(threads_used, sizeof(struct hj_task));
+    pthread_t *threads = calloc(threads_used, sizeof(pthread_t));
+    bool ok = next && tasks && threads
+        && hj_partition(&build_side, key_size, hash_fn, bits, thread_count)
+        && hj_partition(&probe_side, key_size, hash_fn, bits, thread_count);
+
+    size_t started = 0;
+    for (; ok && started < threads_used; started++) {
+        struct hj_task *task = &tasks[started];
+        task->build = &build_side;
+        task->probe = &probe_side;
+        task->next = next;
+        task->key_size = key_size;
+        task->hash = hash_fn;
+        task->cmp = cmp;
+        // Contiguous ranges, so appending the threads in order keeps the partitions in order.
+        task->first = partitions * started / threads_used;
+        task->last = partitions * (started + 1) / threads_used;
+
+        if (!vector_initialize(HJ_BATCH, sizeof(struct hj_pair), &task->pairs)) {
+            ok = false;
+            break;
+        }
+
+        if (threads_used == 1) {
+            hj_worker(task);
+        } else if (pthread_create(&threads[started], NULL, hj_worker, task) != 0) {
+            vector_deinitialize(&task->pairs);
+            ok = false;
+            break;
+        }
+    }
+
+    for (size_t i = 0; i < started; i++) {
+        if (threads_used > 1) {
+            pthread_join(threads[i], NULL);
+        }
+
+        ok = ok && tasks[i].ok && vector_push_back_n(pairs, tasks[i].pairs.items, tasks[i].pairs.size);
+        vector_deinitialize(&tasks[i].pairs);
+    }
+
+    free(build_side.order);
+    free(build_side.bounds);
+    free(probe_side.order);
+    free(probe_side.bounds);
+    free(next);
+    free(tasks);
+    free(threads);
+    return ok;
+}
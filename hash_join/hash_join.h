@@ -0,0 +1,93 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include "../hash_map/hash_map.h"
+#include "../vector/vector.h"
+
+/**
+ * @struct hj_pair
+ * @brief  Rows of the build and probe side whose keys are equal.
+ */
+struct hj_pair {
+    /** Index of the build side row. */
+    size_t build;
+    /** Index of the probe side row. */
+    size_t probe;
+};
+
+/**
+ * @struct hash_join
+ * @brief  Hash table over the rows of a build side vector, probed with the rows of another.
+ *
+ * Rows are records of the vector's element size with the key at a fixed offset.
+ * The hash map holds every distinct key once, mapped to its first row. Further
+ * rows with the same key are chained through `next`, so duplicates on the build
+ * side cost a single table entry.
+ */
+struct hash_join {
+    /** Maps each distinct key to its first build row. */
+    struct hash_map heads;
+    /** Next build row with the same key, one per build row. */
+    size_t *next;
+    /** Build side rows. */
+    const struct vector *build;
+    /** Offset of the key inside a build row. */
+    size_t key_offset;
+    /** Key's size. */
+    size_t key_size;
+};
+
+/**
+ * @brief Builds the hash table over all rows of a vector.
+ * 
+ * @param[in]  build      Build side rows, must outlive the join.
+ * @param[in]  key_offset Offset of the key inside a build row.
+ * @param[in]  key_size   Key's size.
+ * @param[in]  hash       Hash function for the keys, NULL for hm_hash_bytes.
+ * @param[in]  cmp        Custom comparision function used for comparing keys.
+ * @param[out] join       Pointer to caller allocated hash_join struct.
+ * 
+ * @return true if successful, false otherwise.
+ */
+bool hj_build(const struct vector *build, const size_t key_offset, const size_t key_size, const hash_func hash, const cmp_func cmp, struct hash_join *join);
+/**
+ * @brief Probes the hash table with all rows of a vector.
+ *        Keys are looked up in batches with hm_get_many, so their cache misses overlap.
+ * 
+ * @param[in]  join       Pointer to hash_join struct.
+ * @param[in]  probe      Probe side rows.
+ * @param[in]  key_offset Offset of the key inside a probe row.
+ * @param[out] pairs      Initialized vector of hj_pair, every match is appended in probe order.
+ * 
+ * @return true if successful, false otherwise.
+ */
+bool hj_probe(const struct hash_join *join, const struct vector *probe, const size_t key_offset, struct vector *pairs);
+/**
+ * @brief Destroys the hash join.
+ * 
+ * @param[in] join Pointer to hash_join struct.
+ */
+void hj_destroy(struct hash_join *join);
+/**
+ * @brief Joins two vectors with a radix partitioned hash join.
+ *
+ * Both sides are first split on the top bits of the key hashes, then every
+ * partition is built and probed on its own. Partitions are small enough for
+ * their table to stay in cache and are spread over the threads, and so are
+ * the rows while they are hashed and split.
+ * 
+ * @param[in]  build            Build side rows, preferably the smaller side.
+ * @param[in]  build_key_offset Offset of the key inside a build row.
+ * @param[in]  probe            Probe side rows.
+ * @param[in]  probe_key_offset Offset of the key inside a probe row.
+ * @param[in]  key_size         Key's size.
+ * @param[in]  hash             Hash function for the keys, NULL for hm_hash_bytes.
+ * @param[in]  cmp              Custom comparision function used for comparing keys.
+ * @param[in]  partition_bits   Log2 of the number of partitions, at most 14, 0 to size them for the cache.
+ * @param[in]  thread_count     Number of threads.
+ * @param[out] pairs            Initialized vector of hj_pair, every match is appended, grouped by partition.
+ * 
+ * @return true if successful, false otherwise.
+ */
+bool hj_join_partitioned(const struct vector *build, const size_t build_key_offset, const struct vector *probe, const size_t probe_key_offset, const size_t key_size, const hash_func hash, const cmp_func cmp, const unsigned partition_bits, const size_t thread_count, struct vector *pairs);
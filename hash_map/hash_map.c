@@ -1,45 +1,510 @@
 #include "hash_map.h"
 
+#include <stdint.h>
 #include <string.h>
+#ifdef HM_STATS
+#include <stdatomic.h>
+#include <time.h>
+#endif
 
-void hm_init(const size_t key_size, const size_t value_size, const size_t capacity, const cmp_func cmp, struct hash_map *map)
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define HM_USE_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HM_USE_SSE2 1
+#endif
+
+#define HM_ALIGN sizeof(uint64_t)
+#define HM_ALIGN_UP(n) (((n) + HM_ALIGN - 1) & ~(HM_ALIGN - 1))
+#define HM_ENTRY(map, table, index) ((struct hm_entry *)((char *)(table) + ((index) * (map)->entry_size)))
+#define HM_KEY(map, entry) ((void *)((char *)(entry) + (map)->key_offset))
+#define HM_VALUE(map, entry) ((void *)((char *)(entry) + (map)->value_offset))
+/** Keys hashed and prefetched ahead of resolving them in the batched calls. */
+#define HM_BATCH 16
+
+#if defined(__GNUC__) || defined(__clang__)
+#define HM_PREFETCH(addr, rw) __builtin_prefetch((addr), (rw))
+#else
+#define HM_PREFETCH(addr, rw) ((void)(addr))
+#endif
+/** Old buckets migrated by every insert and delete during an incremental resize. */
+#define HM_REHASH_STEP 64
+/** Fraction of the table that may hold tombstones before it is rehashed in place. */
+#define HM_MAX_TOMBSTONES 0.25
+/** Table slots per Bloom filter block, about 23 bits per key at the 0.7 load limit. */
+#define HM_FILTER_SLOTS 16
+
+#ifdef HM_STATS
+/** Runs a statement updating `map->stats`, compiled out without HM_STATS. */
+#define HM_STAT(statement) do { if (map->stats) { statement; } } while (0)
+
+/**
+ * @struct hm_counters
+ * @brief  Counters behind `map->stats`, atomic since lookups may run concurrently under a read lock.
+ */
+struct hm_counters {
+    /** See hm_stats. */
+    atomic_size_t lookup_probes[HM_STATS_PROBE_BUCKETS];
+    /** See hm_stats. */
+    atomic_size_t insert_probes[HM_STATS_PROBE_BUCKETS];
+    /** See hm_stats. */
+    atomic_size_t lookups;
+    /** See hm_stats. */
+    atomic_size_t cmp_calls;
+    /** See hm_stats, writers only. */
+    size_t resizes;
+    /** See hm_stats, writers only. */
+    double resize_seconds;
+};
+
+/**
+ * @brief Adds one to a counter, relaxed since only the totals matter.
+ */
+static inline void hm_stats_count(atomic_size_t *counter)
 {
-    if (key_size == 0 || value_size == 0 || capacity == 0 || !cmp || !map) {
+    atomic_fetch_add_explicit(counter, 1, memory_order_relaxed);
+}
+
+/**
+ * @brief Counts a probe of some length in a histogram.
+ */
+static inline void hm_stats_probe(atomic_size_t *histogram, const size_t probes)
+{
+    hm_stats_count(&histogram[(probes < HM_STATS_PROBE_BUCKETS ? probes : HM_STATS_PROBE_BUCKETS) - 1]);
+}
+
+/**
+ * @brief Current time in seconds.
+ */
+static inline double hm_stats_now(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+#else
+#define HM_STAT(statement) ((void)0)
+#endif
+
+void hm_init(const size_t key_size, const size_t value_size, const size_t capacity, const hash_func hash, const cmp_func cmp, struct hash_map *map)
+{
+    if (!map) {
+        return;
+    }
+
+    // Every field is valid for hm_destroy even if initialization fails below.
+    memset(map, 0, sizeof(*map));
+
+    if (key_size == 0 || value_size == 0 || capacity == 0 || !cmp) {
         return;
     }
 
-    map->table = calloc(capacity, sizeof(struct hm_entry));
+    // [header | key | value], each part padded so the next one stays aligned.
+    const size_t key_offset = HM_ALIGN_UP(sizeof(struct hm_entry));
+    const size_t value_offset = key_offset + HM_ALIGN_UP(key_size);
+    const size_t entry_size = value_offset + HM_ALIGN_UP(value_size);
+
+    // Power of two capacities turn the modulo of every probe step into a mask.
+    size_t rounded = 1;
+    while (rounded < capacity) {
+        rounded <<= 1;
+    }
+
+    // calloc leaves every entry EMPTY.
+    map->table = calloc(rounded, entry_size);
     if (!map->table) {
         return;
     }
 
     map->key_size = key_size;
     map->value_size = value_size;
+    map->entry_size = entry_size;
+    map->key_offset = key_offset;
+    map->value_offset = value_offset;
+    map->hash = hash ? hash : hm_hash_bytes;
     map->cmp = cmp;
-    map->capacity = capacity;
+    map->capacity = rounded;
     map->size = 0;
+    map->probing = HM_PROBE_LINEAR;
+    map->old_table = NULL;
+    map->old_capacity = 0;
+    map->migrate_index = 0;
+    map->tombstones = 0;
+    map->incremental_resize = false;
+    map->filter = NULL;
+    map->filter_blocks = 0;
+    map->filter_stale = 0;
+    map->old_filter = NULL;
+    map->old_filter_blocks = 0;
+#ifdef HM_STATS
+    map->stats = calloc(1, sizeof(struct hm_counters));
+    if (map->stats) {
+        for (size_t i = 0; i < HM_STATS_PROBE_BUCKETS; i++) {
+            atomic_init(&map->stats->lookup_probes[i], 0);
+            atomic_init(&map->stats->insert_probes[i], 0);
+        }
+        atomic_init(&map->stats->lookups, 0);
+        atomic_init(&map->stats->cmp_calls, 0);
+    }
+#else
+    map->stats = NULL;
+#endif
+}
+
+// wyhash secret and seed.
+static const uint64_t hm_secret[4] = {
+    0xa0761d6478bd642full, 0xe7037ed1a0b428dbull, 0x8ebc6af09c88c6e3ull, 0x589965cc75374cc3ull
+};
+#define HM_SEED 0x9e3779b97f4a7c15ull
+
+/**
+ * @brief Multiplies two 64-bit values into 128 bits.
+ * 
+ * @param[in,out] a First factor, low 64 bits of the product on return.
+ * @param[in,out] b Second factor, high 64 bits of the product on return.
+ */
+static inline void hm_mum(uint64_t *a, uint64_t *b)
+{
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = (__uint128_t)*a * *b;
+    *a = (uint64_t)r;
+    *b = (uint64_t)(r >> 64);
+#else
+    const uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t)*a, lb = (uint32_t)*b;
+    const uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    const uint64_t t = rl + (rm0 << 32);
+    uint64_t carry = t < rl;
+    const uint64_t lo = t + (rm1 << 32);
+    carry += lo < t;
+    *a = lo;
+    *b = rh + (rm0 >> 32) + (rm1 >> 32) + carry;
+#endif
+}
+
+/**
+ * @brief Multiplies two 64-bit values and folds the 128-bit product.
+ */
+static inline uint64_t hm_mix(uint64_t a, uint64_t b)
+{
+    hm_mum(&a, &b);
+    return a ^ b;
 }
 
 /**
- * @brief Hashes the key based on a value.
+ * @brief Unaligned loads, memcpy compiles down to a single mov.
+ */
+static inline uint64_t hm_read8(const uint8_t *p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t hm_read4(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+uint64_t hm_hash_bytes(const void *key, const size_t key_size)
+{
+    const uint8_t *p = key;
+    uint64_t seed = HM_SEED ^ hm_mix(HM_SEED ^ hm_secret[0], hm_secret[1]);
+    uint64_t a = 0;
+    uint64_t b = 0;
+    size_t len = key_size;
+
+    if (len <= 16) {
+        if (len >= 4) {
+            // Two overlapping 4 byte reads from each end cover 4..16 bytes.
+            const size_t mid = (len >> 3) << 2;
+            a = (hm_read4(p) << 32) | hm_read4(p + mid);
+            b = (hm_read4(p + len - 4) << 32) | hm_read4(p + len - 4 - mid);
+        } else if (len > 0) {
+            a = ((uint64_t)p[0] << 16) | ((uint64_t)p[len >> 1] << 8) | p[len - 1];
+        }
+    } else {
+        if (len > 48) {
+            // Three independent lanes of 16 bytes each.
+            uint64_t see1 = seed;
+            uint64_t see2 = seed;
+            do {
+                seed = hm_mix(hm_read8(p) ^ hm_secret[1], hm_read8(p + 8) ^ seed);
+                see1 = hm_mix(hm_read8(p + 16) ^ hm_secret[2], hm_read8(p + 24) ^ see1);
+                see2 = hm_mix(hm_read8(p + 32) ^ hm_secret[3], hm_read8(p + 40) ^ see2);
+                p += 48;
+                len -= 48;
+            } while (len > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (len > 16) {
+            seed = hm_mix(hm_read8(p) ^ hm_secret[1], hm_read8(p + 8) ^ seed);
+            p += 16;
+            len -= 16;
+        }
+        // Last 16 bytes, overlapping already hashed ones if needed.
+        a = hm_read8(p + len - 16);
+        b = hm_read8(p + len - 8);
+    }
+
+    a ^= hm_secret[1];
+    b ^= seed;
+    hm_mum(&a, &b);
+    return hm_mix(a ^ hm_secret[0] ^ key_size, b ^ hm_secret[1]);
+}
+
+uint64_t hm_hash_string(const void *key, const size_t key_size)
+{
+    const unsigned char *str = key;
+    uint64_t hash = 5381;
+
+    for (size_t i = 0; i < key_size && str[i]; i++) {
+        hash = ((hash << 5) + hash) + str[i]; // hash * 33 + c
+    }
+
+    return hash;
+}
+
+/**
+ * @brief Number of steps in a probe sequence, long enough to visit every slot.
+ */
+static inline size_t hm_probe_limit(const struct hash_map *map, const size_t capacity)
+{
+    return map->probing == HM_PROBE_QUADRATIC ? capacity * 2 : capacity;
+}
+
+/**
+ * @brief Slot visited at a step of a key's probe sequence.
  * 
- * @param[in] key      Key to hash. Assumes that key is a string.
- * @param[in] capacity Capacity of the hash map.
+ * @param[in] map      Pointer to hash_map struct.
+ * @param[in] hash     Hash of the key.
+ * @param[in] step     Step of the probe sequence, 0 is the home slot.
+ * @param[in] capacity Capacity of the table being probed, a power of two.
  * 
- * @return Index of the hashed key. 
+ * @return Index of the slot.
  */
-size_t hm_simple_hash(const void *key, const size_t capacity)
+static inline size_t hm_probe(const struct hash_map *map, const uint64_t hash, const size_t step, const size_t capacity)
 {
-    // Assumes key is a string (char *)
-    char *str = (char *)key;
-    size_t hash = 5381;
-    int c = 0;
+    const size_t mask = capacity - 1;
+    const size_t home = (size_t)hash & mask;
 
-    while ((c = *str++)) {
-        hash = ((hash << 5) + hash) + c; // hash * 33 + c
+    switch (map->probing) {
+    case HM_PROBE_QUADRATIC:
+        // step * step only reaches part of a power of two table, continue linearly once it is exhausted.
+        return step < capacity ? (home + step * step) & mask : (home + step - capacity) & mask;
+    case HM_PROBE_TRIANGULAR:
+        // 0, 1, 3, 6, ... visits every slot of a power of two table.
+        return (home + step * (step + 1) / 2) & mask;
+    default:
+        return (home + step) & mask;
     }
+}
+
+/**
+ * @brief Finds the entry holding a key in one table.
+ * 
+ * @param[in] map      Pointer to hash_map struct.
+ * @param[in] table    Table to probe, either the current or the old one.
+ * @param[in] capacity Capacity of that table.
+ * @param[in] key      Key to search.
+ * @param[in] hash     Hash of the key.
+ * 
+ * @return Pointer to the entry if found, NULL otherwise.
+ */
+static struct hm_entry *hm_find(const struct hash_map *map, void *table, const size_t capacity, const void *key, const uint64_t hash)
+{
+    const size_t limit = hm_probe_limit(map, capacity);
+
+    for (size_t i = 0; i < limit; i++) {
+        struct hm_entry *entry = HM_ENTRY(map, table, hm_probe(map, hash, i, capacity));
 
-    return hash % capacity;
+        if (entry->state == EMPTY) {
+            HM_STAT(hm_stats_probe(map->stats->lookup_probes, i + 1); hm_stats_count(&map->stats->lookups));
+            return NULL;
+        }
+
+        if (entry->state == OCCUPIED && entry->hash == hash) {
+            HM_STAT(hm_stats_count(&map->stats->cmp_calls));
+            if (map->cmp(HM_KEY(map, entry), key) == 0) {
+                HM_STAT(hm_stats_probe(map->stats->lookup_probes, i + 1); hm_stats_count(&map->stats->lookups));
+                return entry;
+            }
+        }
+    }
+
+    HM_STAT(hm_stats_probe(map->stats->lookup_probes, limit); hm_stats_count(&map->stats->lookups));
+    return NULL;
+}
+
+// Odd multipliers picking one bit per word of a filter block.
+static const uint32_t hm_filter_salt[HM_FILTER_WORDS] = {
+    0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du, 0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u
+};
+
+/**
+ * @brief Finds the filter block of a hash, the high half of the hash selects it.
+ */
+static inline uint32_t *hm_filter_block(uint32_t *filter, const size_t blocks, const uint64_t hash)
+{
+    return filter + ((size_t)(hash >> 32) & (blocks - 1)) * HM_FILTER_WORDS;
+}
+
+/**
+ * @brief Adds a hash to the filter, setting one bit in each word of its block.
+ */
+static inline void hm_filter_add(struct hash_map *map, const uint64_t hash)
+{
+    uint32_t *block = hm_filter_block(map->filter, map->filter_blocks, hash);
+    for (unsigned i = 0; i < HM_FILTER_WORDS; i++) {
+        block[i] |= 1u << (((uint32_t)hash * hm_filter_salt[i]) >> 27);
+    }
+}
+
+/**
+ * @brief Checks a hash against a filter, the current one or the one of an old table.
+ *
+ * @return false if no key with this hash was added, true if one may have been.
+ */
+static inline bool hm_filter_test(uint32_t *filter, const size_t blocks, const uint64_t hash)
+{
+    const uint32_t *block = hm_filter_block(filter, blocks, hash);
+#if defined(HM_USE_AVX2)
+    const __m256i salt = _mm256_loadu_si256((const __m256i *)hm_filter_salt);
+    const __m256i shift = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_set1_epi32((int)(uint32_t)hash), salt), 27);
+    const __m256i bits = _mm256_sllv_epi32(_mm256_set1_epi32(1), shift);
+    return _mm256_testc_si256(_mm256_load_si256((const __m256i *)block), bits);
+#else
+    uint32_t bits[HM_FILTER_WORDS];
+    for (unsigned i = 0; i < HM_FILTER_WORDS; i++) {
+        bits[i] = 1u << (((uint32_t)hash * hm_filter_salt[i]) >> 27);
+    }
+#if defined(HM_USE_SSE2)
+    const __m128i lo = _mm_loadu_si128((const __m128i *)bits);
+    const __m128i hi = _mm_loadu_si128((const __m128i *)(bits + 4));
+    const __m128i hit_lo = _mm_cmpeq_epi32(_mm_and_si128(_mm_load_si128((const __m128i *)block), lo), lo);
+    const __m128i hit_hi = _mm_cmpeq_epi32(_mm_and_si128(_mm_load_si128((const __m128i *)(block + 4)), hi), hi);
+    return _mm_movemask_epi8(_mm_and_si128(hit_lo, hit_hi)) == 0xffff;
+#else
+    for (unsigned i = 0; i < HM_FILTER_WORDS; i++) {
+        if (!(block[i] & bits[i])) {
+            return false;
+        }
+    }
+    return true;
+#endif
+#endif
+}
+
+/**
+ * @brief Rebuilds the filter for the current capacity from the hashes stored in the entries.
+ *
+ * Keys of an in progress migration are added from both tables. If the new filter
+ * cannot be allocated the filter is dropped, lookups then just probe.
+ *
+ * @param[in] map Pointer to hash_map struct.
+ */
+static void hm_filter_build(struct hash_map *map)
+{
+    size_t blocks = 1;
+    while (blocks * HM_FILTER_SLOTS < map->capacity) {
+        blocks <<= 1;
+    }
+
+    if (blocks != map->filter_blocks) {
+        free(map->filter);
+        map->filter = aligned_alloc(HM_FILTER_WORDS * sizeof(uint32_t), blocks * HM_FILTER_WORDS * sizeof(uint32_t));
+        if (!map->filter) {
+            map->filter_blocks = 0;
+            return;
+        }
+        map->filter_blocks = blocks;
+    }
+
+    memset(map->filter, 0, blocks * HM_FILTER_WORDS * sizeof(uint32_t));
+    map->filter_stale = 0;
+
+    // Covers both tables, the old table's filter is no longer needed.
+    free(map->old_filter);
+    map->old_filter = NULL;
+    map->old_filter_blocks = 0;
+
+    for (size_t i = 0; i < map->capacity; i++) {
+        const struct hm_entry *entry = HM_ENTRY(map, map->table, i);
+        if (entry->state == OCCUPIED) {
+            hm_filter_add(map, entry->hash);
+        }
+    }
+    for (size_t i = 0; i < map->old_capacity; i++) {
+        const struct hm_entry *entry = HM_ENTRY(map, map->old_table, i);
+        if (entry->state == OCCUPIED) {
+            hm_filter_add(map, entry->hash);
+        }
+    }
+}
+
+/**
+ * @brief Starts an empty filter for a table an incremental resize has just replaced.
+ *
+ * The current filter becomes the old table's, a filter for the new capacity is
+ * filled by hm_migrate and inserts. If it cannot be allocated both are dropped.
+ *
+ * @param[in] map Pointer to hash_map struct, `old_table` set.
+ */
+static void hm_filter_start(struct hash_map *map)
+{
+    size_t blocks = 1;
+    while (blocks * HM_FILTER_SLOTS < map->capacity) {
+        blocks <<= 1;
+    }
+
+    free(map->old_filter);
+    map->old_filter = map->filter;
+    map->old_filter_blocks = map->filter_blocks;
+
+    map->filter = aligned_alloc(HM_FILTER_WORDS * sizeof(uint32_t), blocks * HM_FILTER_WORDS * sizeof(uint32_t));
+    if (!map->filter) {
+        free(map->old_filter);
+        map->old_filter = NULL;
+        map->old_filter_blocks = 0;
+        map->filter_blocks = 0;
+        return;
+    }
+
+    memset(map->filter, 0, blocks * HM_FILTER_WORDS * sizeof(uint32_t));
+    map->filter_blocks = blocks;
+    map->filter_stale = 0;
+}
+
+bool hm_enable_filter(struct hash_map *map)
+{
+    if (!map || !map->table) {
+        return false;
+    }
+
+    hm_filter_build(map);
+    return map->filter != NULL;
+}
+
+void *hm_get_hashed(const struct hash_map *map, const void *key, const uint64_t hash)
+{
+    if (!map || !key) {
+        return NULL;
+    }
+
+    if (map->filter && !hm_filter_test(map->filter, map->filter_blocks, hash)
+        && !(map->old_filter && hm_filter_test(map->old_filter, map->old_filter_blocks, hash))) {
+        return NULL;
+    }
+
+    struct hm_entry *entry = hm_find(map, map->table, map->capacity, key, hash);
+    if (!entry && map->old_table) {
+        // Not migrated yet.
+        entry = hm_find(map, map->old_table, map->old_capacity, key, hash);
+    }
+
+    return entry ? HM_VALUE(map, entry) : NULL;
 }
 
 void *hm_get(const struct hash_map *map, const void *key)
@@ -48,60 +513,288 @@ void *hm_get(const struct hash_map *map, const void *key)
         return NULL;
     }
 
-    const size_t index = hm_simple_hash(key, map->capacity);
-    
-    for (size_t i = 0; i < map->capacity; i++) {
-        size_t probe_entry = (index + i) % map->capacity;
-        struct hm_entry *entry = &map->table[probe_entry];
+    return hm_get_hashed(map, key, map->hash(key, map->key_size));
+}
 
-        if (entry->state == EMPTY) {
-            return NULL;
+void hm_get_many(const struct hash_map *map, const void *keys, const size_t count, void **values)
+{
+    if (!map || !keys || !values) {
+        return;
+    }
+
+    uint64_t hashes[HM_BATCH];
+
+    for (size_t start = 0; start < count; start += HM_BATCH) {
+        const size_t n = count - start < HM_BATCH ? count - start : HM_BATCH;
+        const char *batch = (const char *)keys + start * map->key_size;
+
+        // Issue every home slot's load first, so the misses overlap instead of queuing up.
+        for (size_t i = 0; i < n; i++) {
+            hashes[i] = map->hash(batch + i * map->key_size, map->key_size);
+            HM_PREFETCH(HM_ENTRY(map, map->table, hashes[i] & (map->capacity - 1)), 0);
         }
 
-        if (entry->state == OCCUPIED && map->cmp(entry->key, key) == 0) {
-            return entry->value;
+        for (size_t i = 0; i < n; i++) {
+            values[start + i] = hm_get_hashed(map, batch + i * map->key_size, hashes[i]);
         }
     }
+}
 
-    return NULL;
+/**
+ * @brief Migrates buckets of an in progress resize, see hm_rehash_step.
+ * 
+ * @param[in] map     Pointer to hash_map struct.
+ * @param[in] buckets Maximum number of old buckets to migrate.
+ */
+static void hm_migrate(struct hash_map *map, const size_t buckets)
+{
+    if (!map->old_table) {
+        return;
+    }
+
+    const size_t end = map->migrate_index + buckets < map->old_capacity ? map->migrate_index + buckets : map->old_capacity;
+
+    for (; map->migrate_index < end; map->migrate_index++) {
+        struct hm_entry *old_entry = HM_ENTRY(map, map->old_table, map->migrate_index);
+        if (old_entry->state != OCCUPIED) {
+            continue;
+        }
+
+        // Keys are unique, so the first free slot in the new table is the right one.
+        struct hm_entry *new_entry = HM_ENTRY(map, map->table, hm_probe(map, old_entry->hash, 0, map->capacity));
+        for (size_t i = 1; new_entry->state == OCCUPIED; i++) {
+            new_entry = HM_ENTRY(map, map->table, hm_probe(map, old_entry->hash, i, map->capacity));
+        }
+        if (new_entry->state == DELETED) {
+            map->tombstones--;
+        }
+        memcpy(new_entry, old_entry, map->entry_size);
+        if (map->filter) {
+            hm_filter_add(map, old_entry->hash);
+        }
+
+        // Leave a tombstone, so probe chains of keys still in the old table stay intact.
+        old_entry->state = DELETED;
+    }
+
+    if (map->migrate_index == map->old_capacity) {
+        free(map->old_table);
+        map->old_table = NULL;
+        map->old_capacity = 0;
+        map->migrate_index = 0;
+        free(map->old_filter);
+        map->old_filter = NULL;
+        map->old_filter_blocks = 0;
+    }
+}
+
+void hm_rehash_step(struct hash_map *map, const size_t buckets)
+{
+    if (!map || !map->old_table) {
+        return;
+    }
+
+#ifdef HM_STATS
+    const double start = hm_stats_now();
+#endif
+    hm_migrate(map, buckets);
+    HM_STAT(map->stats->resize_seconds += hm_stats_now() - start);
+}
+
+/**
+ * @brief Moves every entry into a new table, dropping all tombstones.
+ *
+ * Entries are moved by copying them into the new slab, so no key or value is reallocated.
+ * With `incremental_resize` only the new table is set up here, the entries are moved
+ * HM_REHASH_STEP buckets at a time by the following inserts and deletes.
+ * 
+ * @param[in] map          Pointer to hash_map struct. 
+ * @param[in] new_capacity Capacity of the new table, the current one to only drop tombstones.
+ */
+static void hm_rehash(struct hash_map *map, const size_t new_capacity)
+{
+#ifdef HM_STATS
+    const double start = hm_stats_now();
+#endif
+
+    // Only one migration at a time, finish the previous one first.
+    hm_migrate(map, map->old_capacity);
+
+    void *new_table = calloc(new_capacity, map->entry_size);
+    if (!new_table) {
+        return;
+    }
+
+    map->old_table = map->table;
+    map->old_capacity = map->capacity;
+    map->migrate_index = 0;
+    map->table = new_table;
+    map->capacity = new_capacity;
+    map->tombstones = 0;
+
+    if (map->filter && map->incremental_resize) {
+        // Walking the tables would bring the pause back, hm_migrate adds the keys as it moves them.
+        hm_filter_start(map);
+    }
+
+    if (!map->incremental_resize) {
+        hm_migrate(map, map->old_capacity);
+        if (map->filter) {
+            hm_filter_build(map);
+        }
+    }
+
+    HM_STAT(map->stats->resizes++; map->stats->resize_seconds += hm_stats_now() - start);
 }
 
 /**
  * @brief Dynamically resizes the hash map if it reaches certain threshold.
+ *
+ * Tombstones count towards the load. If they make up most of it the table is
+ * rehashed at the same capacity instead of doubling.
  * 
  * @param[in] map Pointer to hash_map struct. 
  */
 void hm_resize(struct hash_map *map)
 {
-    const size_t new_capacity = map->capacity * 2;
-    struct hm_entry *new_table = malloc(new_capacity * sizeof(struct hm_entry));
-    if (!new_table) {
+    if (map->size + map->tombstones < map->capacity * 0.7) {
         return;
     }
 
-    for (size_t i = 0; i < new_capacity; i++) {
-        new_table[i].state = EMPTY;
+    hm_rehash(map, map->size >= map->capacity * 0.35 ? map->capacity * 2 : map->capacity);
+}
+
+/**
+ * @brief Removes an entry from the current table with backward shift deletion.
+ *
+ * Following entries of the probe chain are moved back into the hole until one
+ * sits in its home slot or an EMPTY slot is reached, so no tombstone is needed.
+ * Only valid for linear probing, other schemes leave a tombstone.
+ * 
+ * @param[in] map   Pointer to hash_map struct.
+ * @param[in] index Index of the entry to remove.
+ */
+static void hm_remove(struct hash_map *map, size_t index)
+{
+    const size_t mask = map->capacity - 1;
+    size_t next = index;
+
+    if (map->probing != HM_PROBE_LINEAR) {
+        HM_ENTRY(map, map->table, index)->state = DELETED;
+        map->tombstones++;
+        return;
     }
 
-    // Save old table
-    struct hm_entry *old_table = map->table;
-    const size_t old_capacity = map->capacity;
+    for (;;) {
+        next = (next + 1) & mask;
+        struct hm_entry *entry = HM_ENTRY(map, map->table, next);
 
-    map->table = new_table;
-    map->capacity = new_capacity;
-    map->size = 0;
+        if (entry->state == EMPTY) {
+            break;
+        }
+
+        if (entry->state == DELETED) {
+            // Chains may run through the tombstone and the hole, keep both.
+            HM_ENTRY(map, map->table, index)->state = DELETED;
+            map->tombstones++;
+            return;
+        }
+
+        // Entries whose home is cyclically in (index, next] must stay where they are.
+        const size_t home = (size_t)entry->hash & mask;
+        const bool stays = index <= next ? (index < home && home <= next) : (index < home || home <= next);
+        if (stays) {
+            continue;
+        }
+
+        memcpy(HM_ENTRY(map, map->table, index), entry, map->entry_size);
+        index = next;
+    }
+
+    HM_ENTRY(map, map->table, index)->state = EMPTY;
+}
+
+/**
+ * @brief Finds the value slot of an already hashed key, adding the key if it is missing.
+ * 
+ * @param[in]  map      Pointer to hash_map struct.
+ * @param[in]  key      Key to find or insert.
+ * @param[in]  hash     Hash of the key.
+ * @param[out] inserted Set to whether the key was added, its value is then uninitialized.
+ * 
+ * @return Pointer to the key's value, NULL if it could not be added.
+ */
+static void *hm_slot_hashed(struct hash_map *map, const void *key, const uint64_t hash, bool *inserted)
+{
+    hm_rehash_step(map, HM_REHASH_STEP);
+    hm_resize(map);
+
+    *inserted = false;
+
+    if (map->old_table) {
+        // A key that is not migrated yet is updated where it is.
+        struct hm_entry *entry = hm_find(map, map->old_table, map->old_capacity, key, hash);
+        if (entry) {
+            return HM_VALUE(map, entry);
+        }
+    }
+
+    const size_t limit = hm_probe_limit(map, map->capacity);
+    struct hm_entry *free_entry = NULL;
+
+    for (size_t i = 0; i < limit; i++) {
+        struct hm_entry *entry = HM_ENTRY(map, map->table, hm_probe(map, hash, i, map->capacity));
 
-    for (size_t i = 0; i < old_capacity; i++) {
-        struct hm_entry *old_entry = &old_table[i];
-        if (old_entry->state == OCCUPIED) {
-            // re-insert the entry into the new table
-            hm_insert(map, old_entry->key, old_entry->value);
-            free(old_entry->key);
-            free(old_entry->value);
+        if (entry->state == OCCUPIED && entry->hash == hash && map->cmp(HM_KEY(map, entry), key) == 0) {
+            HM_STAT(hm_stats_probe(map->stats->insert_probes, i + 1));
+            return HM_VALUE(map, entry);
+        }
+
+        // Reuse the first tombstone, but keep probing as the key may still be further along.
+        if (entry->state == DELETED && !free_entry) {
+            free_entry = entry;
+        }
+
+        if (entry->state == EMPTY) {
+            if (!free_entry) {
+                free_entry = entry;
+            }
+            HM_STAT(hm_stats_probe(map->stats->insert_probes, i + 1));
+            break;
         }
     }
 
-    free(old_table);
+    if (!free_entry) {
+        return NULL;
+    }
+
+    if (free_entry->state == DELETED) {
+        map->tombstones--;
+    }
+    free_entry->hash = hash;
+    memcpy(HM_KEY(map, free_entry), key, map->key_size);
+    free_entry->state = OCCUPIED;
+    map->size++;
+
+    if (map->filter) {
+        hm_filter_add(map, hash);
+    }
+
+    *inserted = true;
+    return HM_VALUE(map, free_entry);
+}
+
+void hm_insert_hashed(struct hash_map *map, const void *key, const void *value, const uint64_t hash)
+{
+    if (!map || !key || !value) {
+        return;
+    }
+
+    bool inserted;
+    void *slot = hm_slot_hashed(map, key, hash, &inserted);
+    if (slot) {
+        memcpy(slot, value, map->value_size);
+    }
 }
 
 void hm_insert(struct hash_map *map, const void *key, const void *value)
@@ -110,65 +803,140 @@ void hm_insert(struct hash_map *map, const void *key, const void *value)
         return;
     }
 
-    if (map->size >= map->capacity * 0.7) {
-        hm_resize(map);
+    hm_insert_hashed(map, key, value, map->hash(key, map->key_size));
+}
+
+void *hm_get_or_insert(struct hash_map *map, const void *key, bool *inserted)
+{
+    bool added = false;
+    void *slot = NULL;
+
+    if (map && key) {
+        slot = hm_slot_hashed(map, key, map->hash(key, map->key_size), &added);
+        if (added) {
+            memset(slot, 0, map->value_size);
+        }
     }
 
-    const size_t index = hm_simple_hash(key, map->capacity);
+    if (inserted) {
+        *inserted = added;
+    }
+    return slot;
+}
 
-    for (size_t i = 0; i < map->capacity; i++) {
-        const size_t probe_entry = (index + i) % map->capacity;
-        struct hm_entry *entry = &map->table[probe_entry];
+void hm_upsert(struct hash_map *map, const void *key, const hm_upsert_func init_fn, const hm_upsert_func update_fn, void *ctx)
+{
+    if (!map || !key) {
+        return;
+    }
 
-        if (entry->state == EMPTY || entry->state == DELETED) {
-            entry->key = malloc(map->key_size);
-            if (!entry->key) {
-                return;
-            }
-            memcpy(entry->key, key, map->key_size);
-            entry->value = malloc(map->value_size);
-            if (!entry->value) {
-                free(entry->key);
-                entry->key = NULL;
-                return;
-            }
-            memcpy(entry->value, value, map->value_size);
-            entry->state = OCCUPIED;
-            map->size++;
-            return;
+    bool inserted;
+    void *slot = hm_slot_hashed(map, key, map->hash(key, map->key_size), &inserted);
+    if (!slot) {
+        return;
+    }
+
+    if (inserted) {
+        memset(slot, 0, map->value_size);
+        if (init_fn) {
+            init_fn(key, slot, ctx);
         }
+    } else if (update_fn) {
+        update_fn(key, slot, ctx);
+    }
+}
 
-        if (entry->state == OCCUPIED && map->cmp(entry->key, key) == 0) {
-            memcpy(entry->value, value, map->value_size);
-            return;
+void hm_insert_many(struct hash_map *map, const void *keys, const void *values, const size_t count)
+{
+    if (!map || !keys || !values) {
+        return;
+    }
+
+    uint64_t hashes[HM_BATCH];
+
+    for (size_t start = 0; start < count; start += HM_BATCH) {
+        const size_t n = count - start < HM_BATCH ? count - start : HM_BATCH;
+        const char *key_batch = (const char *)keys + start * map->key_size;
+        const char *value_batch = (const char *)values + start * map->value_size;
+
+        // Only hashes are kept, a resize in the middle of the batch just wastes the prefetches.
+        for (size_t i = 0; i < n; i++) {
+            hashes[i] = map->hash(key_batch + i * map->key_size, map->key_size);
+            HM_PREFETCH(HM_ENTRY(map, map->table, hashes[i] & (map->capacity - 1)), 1);
+        }
+
+        for (size_t i = 0; i < n; i++) {
+            hm_insert_hashed(map, key_batch + i * map->key_size, value_batch + i * map->value_size, hashes[i]);
         }
     }
 }
 
 void hm_delete(struct hash_map *map, const void *key)
 {
-    const size_t index = hm_simple_hash(key, map->capacity);
+    if (!map || !key) {
+        return;
+    }
 
-    for (size_t i = 0; i < map->capacity; i++) {
-        const size_t probe = (index + i) % map->capacity;
-        struct hm_entry *entry = &map->table[probe];
+    hm_delete_hashed(map, key, map->hash(key, map->key_size));
+}
 
-        if (entry->state == EMPTY) {
-            // Key not found
+void hm_delete_hashed(struct hash_map *map, const void *key, const uint64_t hash)
+{
+    if (!map || !key) {
+        return;
+    }
+
+    hm_rehash_step(map, HM_REHASH_STEP);
+
+    struct hm_entry *entry = hm_find(map, map->table, map->capacity, key, hash);
+    if (entry) {
+        hm_remove(map, (size_t)((char *)entry - (char *)map->table) / map->entry_size);
+        map->size--;
+    } else if (map->old_table) {
+        // The old table keeps tombstones, migration relies on its probe chains.
+        entry = hm_find(map, map->old_table, map->old_capacity, key, hash);
+        if (!entry) {
             return;
         }
+        entry->state = DELETED;
+        map->size--;
+    } else {
+        return;
+    }
 
-        if (entry->state == OCCUPIED && map->cmp(entry->key, key) == 0) {
-            // Key found, mark as deleted
-            free(entry->key);
-            entry->key = NULL;
-            free(entry->value);
-            entry->value = NULL;
-            entry->state = DELETED;
-            map->size--;
-            return;
+    if (map->tombstones >= map->capacity * HM_MAX_TOMBSTONES) {
+        hm_rehash(map, map->capacity);
+    } else if (map->filter && ++map->filter_stale >= map->capacity * HM_MAX_TOMBSTONES && !map->old_table) {
+        // Bits of deleted keys are never cleared, rebuild before they raise the false positive rate.
+        // Deferred while migrating, the rebuild would walk both tables at once.
+        hm_filter_build(map);
+    }
+}
+
+void hm_get_stats(const struct hash_map *map, struct hm_stats *stats)
+{
+    if (!map || !stats) {
+        return;
+    }
+
+    memset(stats, 0, sizeof(*stats));
+#ifdef HM_STATS
+    const struct hm_counters *counters = map->stats;
+    if (counters) {
+        for (size_t i = 0; i < HM_STATS_PROBE_BUCKETS; i++) {
+            stats->lookup_probes[i] = atomic_load_explicit(&counters->lookup_probes[i], memory_order_relaxed);
+            stats->insert_probes[i] = atomic_load_explicit(&counters->insert_probes[i], memory_order_relaxed);
         }
+        stats->lookups = atomic_load_explicit(&counters->lookups, memory_order_relaxed);
+        stats->cmp_calls = atomic_load_explicit(&counters->cmp_calls, memory_order_relaxed);
+        stats->resizes = counters->resizes;
+        stats->resize_seconds = counters->resize_seconds;
     }
+#endif
+
+    stats->cmp_per_lookup = stats->lookups ? (double)stats->cmp_calls / (double)stats->lookups : 0.0;
+    stats->tombstones = map->tombstones;
+    stats->load_factor = map->capacity ? (double)map->size / (double)map->capacity : 0.0;
 }
 
 void hm_destroy(struct hash_map *map)
@@ -177,19 +945,24 @@ void hm_destroy(struct hash_map *map)
         return;
     }
 
-    for (size_t i = 0; i < map->capacity; i++) {
-        struct hm_entry *entry = &map->table[i];
-        if (entry->state == OCCUPIED) {
-            free(entry->key);
-            entry->key = NULL;
-            free(entry->value);
-            entry->value = NULL;
-        }
-    }
+    free(map->stats);
+    map->stats = NULL;
 
+    free(map->filter);
+    map->filter = NULL;
+    map->filter_blocks = 0;
+    map->filter_stale = 0;
+    free(map->old_filter);
+    map->old_filter = NULL;
+    map->old_filter_blocks = 0;
     free(map->table);
     map->table = NULL;
+    free(map->old_table);
+    map->old_table = NULL;
+    map->old_capacity = 0;
+    map->migrate_index = 0;
     map->capacity = 0;
+    map->tombstones = 0;
     map->cmp = NULL;
     map->size = 0;
-}
\ No newline at end of file
+}
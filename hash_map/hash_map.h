@@ -1,5 +1,7 @@
 #pragma once
 
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 
 /**
@@ -13,6 +15,27 @@
  */
 typedef int (*cmp_func)(const void *, const void *);
 
+/**
+ * @typedef hash_func
+ * @brief   Custom hash function.
+ * 
+ * @param[in] key      Key to hash.
+ * @param[in] key_size Key's size as given to hm_init.
+ * 
+ * @return 64-bit hash of the key. Keys that compare equal must hash equal.
+ */
+typedef uint64_t (*hash_func)(const void *key, const size_t key_size);
+
+/**
+ * @typedef hm_upsert_func
+ * @brief   Initializes or updates a value in place, see hm_upsert.
+ * 
+ * @param[in]     key   Key of the entry.
+ * @param[in,out] value Value slot of the entry.
+ * @param[in]     ctx   Context given to hm_upsert.
+ */
+typedef void (*hm_upsert_func)(const void *key, void *value, void *ctx);
+
 /**
  * @enum  entry_state
  * @brief State for tracking entries.
@@ -26,19 +49,73 @@ enum entry_state {
     DELETED
 };
 
+/**
+ * @enum  hm_probing
+ * @brief Probe sequence used to resolve collisions.
+ */
+enum hm_probing {
+    /** home, home + 1, home + 2, ... Cache friendly, deletes need no tombstones. */
+    HM_PROBE_LINEAR,
+    /** home, home + 1, home + 4, ... Then linear once the squares stop reaching new slots. */
+    HM_PROBE_QUADRATIC,
+    /** home, home + 1, home + 3, home + 6, ... Breaks up clusters and still visits every slot. */
+    HM_PROBE_TRIANGULAR
+};
+
 /**
  * @struct hm_entry
- * @brief  Entry for the hash map.
+ * @brief  Header of an entry in the hash map.
+ *
+ * Entries are stored inline in the table: each slot is this header followed
+ * by the key and then the value, both padded to 8 bytes.
  */
 struct hm_entry {
-    /** Key of the value. */
-    void *key;
-    /** Value of the key. */
-    void *value;
+    /** Full hash of the key, compared before calling `cmp` and reused on resize. */
+    uint64_t hash;
     /** State of the entry. */
     enum entry_state state;
 };
 
+/** 32-bit words of a Bloom filter block, one 256-bit block never straddles a cache line. */
+#define HM_FILTER_WORDS 8
+
+/** Buckets of the probe length histograms, the last one also counts all longer probes. */
+#define HM_STATS_PROBE_BUCKETS 16
+
+/** Counters a map collects with HM_STATS, private to hash_map.c. */
+struct hm_counters;
+
+/**
+ * @struct hm_stats
+ * @brief  Probe behavior of a hash map, filled by hm_get_stats.
+ *
+ * The counters are only collected when hash_map.c is built with HM_STATS defined,
+ * otherwise they stay 0 and cost nothing. Callers need not define it. Lookup and
+ * insert counters are relaxed atomic increments, so readers sharing a map under a
+ * read lock, like the shards of concurrent_hash_map, may count concurrently. The
+ * resize time is only updated by writers.
+ */
+struct hm_stats {
+    /** Lookups (hm_get, hm_delete) by number of slots probed, index 0 is 1 slot. */
+    size_t lookup_probes[HM_STATS_PROBE_BUCKETS];
+    /** Inserts by number of slots probed, index 0 is 1 slot. */
+    size_t insert_probes[HM_STATS_PROBE_BUCKETS];
+    /** Number of lookups. */
+    size_t lookups;
+    /** Number of `cmp` calls made by lookups. */
+    size_t cmp_calls;
+    /** Average `cmp` calls per lookup. */
+    double cmp_per_lookup;
+    /** Number of resizes and tombstone cleanups. */
+    size_t resizes;
+    /** Total time spent resizing, including incremental migration steps. */
+    double resize_seconds;
+    /** Current number of tombstones. Always filled. */
+    size_t tombstones;
+    /** Current load factor, entries over capacity. Always filled. */
+    double load_factor;
+};
+
 /**
  * @struct hash_map
  * @brief  Hash map.
@@ -48,26 +125,96 @@ struct hash_map {
     size_t key_size;
     /** Value's size. */
     size_t value_size;
-    /** Table of hash entries. */
-    struct hm_entry *table;
+    /** Slab of inline entries, `capacity * entry_size` bytes. */
+    void *table;
+    /** Size of a single inline entry (header, key and value). */
+    size_t entry_size;
+    /** Offset of the key inside an entry. */
+    size_t key_offset;
+    /** Offset of the value inside an entry. */
+    size_t value_offset;
     /** Current size of the hash map. */
     size_t size;
-    /** Capacity of the hash map. */
+    /** Capacity of the hash map, always a power of two. */
     size_t capacity;
+    /**
+     * Probe sequence, linear after hm_init. Set it before the first insert.
+     * Deletes leave tombstones with anything but linear probing.
+     */
+    enum hm_probing probing;
+    /** Number of DELETED entries in the table, it is rehashed once they pile up. */
+    size_t tombstones;
+    /** Table being migrated by an incremental resize, NULL otherwise. */
+    void *old_table;
+    /** Capacity of the old table. */
+    size_t old_capacity;
+    /** Next bucket of the old table to migrate. */
+    size_t migrate_index;
+    /**
+     * Spread resizes over the following inserts and deletes instead of moving every
+     * entry at once. Off after hm_init, set it before the first insert.
+     */
+    bool incremental_resize;
+    /**
+     * Optional blocked Bloom filter of the keys' hashes, `filter_blocks` blocks of
+     * HM_FILTER_WORDS words, NULL unless enabled with hm_enable_filter.
+     */
+    uint32_t *filter;
+    /** Number of filter blocks, a power of two. */
+    size_t filter_blocks;
+    /** Keys deleted since the filter was built, their bits are still set. */
+    size_t filter_stale;
+    /**
+     * Filter of the table before an incremental resize, kept until the migration
+     * ends since `filter` only holds the keys already moved or inserted since.
+     */
+    uint32_t *old_filter;
+    /** Number of blocks of the old filter. */
+    size_t old_filter_blocks;
+    /** Hash function for the keys. */
+    hash_func hash;
     /** Custom comparasion function for comparing keys. */
     cmp_func cmp;
+    /**
+     * Collected counters, behind a pointer so const lookups can update them.
+     * Always present so the layout does not depend on HM_STATS, NULL without it.
+     */
+    struct hm_counters *stats;
 };
 
+/**
+ * @brief Hashes exactly `key_size` bytes of the key, 8 bytes at a time (wyhash).
+ *        Default hash function, suited for integer, struct and other binary keys.
+ * 
+ * @param[in] key      Key to hash.
+ * @param[in] key_size Number of bytes to hash.
+ * 
+ * @return 64-bit hash of the key.
+ */
+uint64_t hm_hash_bytes(const void *key, const size_t key_size);
+/**
+ * @brief Hashes a NUL-terminated string key (DJB2), ignoring bytes after the terminator.
+ *        Use it for string keys compared with strcmp.
+ * 
+ * @param[in] key      String key to hash.
+ * @param[in] key_size Key's buffer size, hashing stops there if no terminator is found.
+ * 
+ * @return 64-bit hash of the string.
+ */
+uint64_t hm_hash_string(const void *key, const size_t key_size);
+
 /**
  * @brief Initializes the hash map.
+ *        Every field is zeroed first, so hm_destroy is safe even if `table` stays NULL.
  * 
  * @param[in]  key_size   Key's size.
  * @param[in]  value_size Value's size.
- * @param[in]  capacity   Initial capacity of the hash map.
+ * @param[in]  capacity   Initial capacity of the hash map, rounded up to a power of two.
+ * @param[in]  hash       Hash function for the keys, NULL for hm_hash_bytes.
  * @param[in]  cmp        Custom comparision function used for comparing keys.
  * @param[out] map        Pointer to caller allocated hash_map struct.
  */
-void hm_init(const size_t key_size, const size_t value_size, const size_t capacity, const cmp_func cmp, struct hash_map *map);
+void hm_init(const size_t key_size, const size_t value_size, const size_t capacity, const hash_func hash, const cmp_func cmp, struct hash_map *map);
 /**
  * @brief Gets value from its key.
  * 
@@ -75,8 +222,30 @@ void hm_init(const size_t key_size, const size_t value_size, const size_t capaci
  * @param[in] key Key to search.
  * 
  * @return Key's value if found and successful, NULL otherwise. 
+ *         The pointer is into the table and is valid until the next insert or delete.
  */
 void *hm_get(const struct hash_map *map, const void *key);
+/**
+ * @brief Gets value from its already hashed key, for callers that need the hash themselves.
+ * 
+ * @param[in] map  Pointer to hash_map struct.
+ * @param[in] key  Key to search.
+ * @param[in] hash Hash of the key, must be `map->hash(key, key_size)`.
+ * 
+ * @return Key's value if found, NULL otherwise. Valid until the next insert or delete.
+ */
+void *hm_get_hashed(const struct hash_map *map, const void *key, const uint64_t hash);
+/**
+ * @brief Gets the values of a batch of keys.
+ *        All keys of a batch are hashed and their slots prefetched before any is probed,
+ *        so cache misses of different keys overlap.
+ * 
+ * @param[in]  map    Pointer to hash_map struct.
+ * @param[in]  keys   Array of `count` keys, `key_size` bytes each.
+ * @param[in]  count  Number of keys.
+ * @param[out] values Array of `count` pointers, set like hm_get's return value.
+ */
+void hm_get_many(const struct hash_map *map, const void *keys, const size_t count, void **values);
 /**
  * @brief Inserts a key into the hash map.
  * 
@@ -85,13 +254,93 @@ void *hm_get(const struct hash_map *map, const void *key);
  * @param[in] value Value to insert.
  */
 void hm_insert(struct hash_map *map, const void *key, const void *value);
+/**
+ * @brief Inserts an already hashed key into the hash map.
+ * 
+ * @param[in] map   Pointer to hash_map struct.
+ * @param[in] key   Key to insert.
+ * @param[in] value Value to insert.
+ * @param[in] hash  Hash of the key, must be `map->hash(key, key_size)`.
+ */
+void hm_insert_hashed(struct hash_map *map, const void *key, const void *value, const uint64_t hash);
+/**
+ * @brief Gets the value slot of a key, inserting the key with a zeroed value if it is missing.
+ *        The key is hashed and probed once, the value can be updated in place.
+ * 
+ * @param[in]  map      Pointer to hash_map struct.
+ * @param[in]  key      Key to find or insert.
+ * @param[out] inserted Optional pointer set to whether the key was inserted.
+ * 
+ * @return Key's value if successful, NULL otherwise.
+ *         The pointer is into the table and is valid until the next insert or delete.
+ */
+void *hm_get_or_insert(struct hash_map *map, const void *key, bool *inserted);
+/**
+ * @brief Updates the value of a key in place, or inserts the key if it is missing.
+ *        A new value is zeroed and passed to `init_fn`, an existing one to `update_fn`.
+ *        The key is hashed and probed once and the value is never copied.
+ * 
+ * @param[in] map       Pointer to hash_map struct.
+ * @param[in] key       Key to update or insert.
+ * @param[in] init_fn   Optional function initializing a new value.
+ * @param[in] update_fn Optional function updating an existing value.
+ * @param[in] ctx       Context passed to both functions.
+ */
+void hm_upsert(struct hash_map *map, const void *key, const hm_upsert_func init_fn, const hm_upsert_func update_fn, void *ctx);
+/**
+ * @brief Inserts a batch of keys, prefetching their slots like hm_get_many.
+ * 
+ * @param[in] map    Pointer to hash_map struct.
+ * @param[in] keys   Array of `count` keys, `key_size` bytes each.
+ * @param[in] values Array of `count` values, `value_size` bytes each.
+ * @param[in] count  Number of entries.
+ */
+void hm_insert_many(struct hash_map *map, const void *keys, const void *values, const size_t count);
 /**
  * @brief Deletes an entry in the hash map.
+ *        Later entries of the probe chain are shifted back instead of leaving a tombstone.
  * 
  * @param[in] map Pointer to hash_map struct.
  * @param[in] key Key to delete.
  */
 void hm_delete(struct hash_map *map, const void *key);
+/**
+ * @brief Puts a blocked Bloom filter in front of lookups.
+ *        A key that is not in the map is then usually rejected after reading a
+ *        single cache line, instead of probing until an EMPTY slot. The filter is
+ *        updated by inserts and rebuilt on resize, and costs 2 bytes per slot.
+ *        With `incremental_resize` the new filter is filled as entries migrate and
+ *        lookups check the old one too until the migration ends.
+ * 
+ * @param[in] map Pointer to hash_map struct.
+ * 
+ * @return true if successful, false otherwise.
+ */
+bool hm_enable_filter(struct hash_map *map);
+/**
+ * @brief Deletes an already hashed key from the hash map.
+ * 
+ * @param[in] map  Pointer to hash_map struct.
+ * @param[in] key  Key to delete.
+ * @param[in] hash Hash of the key, must be `map->hash(key, key_size)`.
+ */
+void hm_delete_hashed(struct hash_map *map, const void *key, const uint64_t hash);
+/**
+ * @brief Migrates buckets of an in progress incremental resize.
+ *        Inserts and deletes already do this, call it to finish a migration during read-only phases.
+ * 
+ * @param[in] map     Pointer to hash_map struct.
+ * @param[in] buckets Maximum number of old buckets to migrate.
+ */
+void hm_rehash_step(struct hash_map *map, const size_t buckets);
+/**
+ * @brief Reports the probe behavior of the hash map.
+ *        Safe next to concurrent lookups, not next to a writer.
+ * 
+ * @param[in]  map   Pointer to hash_map struct.
+ * @param[out] stats Pointer to caller allocated hm_stats struct.
+ */
+void hm_get_stats(const struct hash_map *map, struct hm_stats *stats);
 /**
  * @brief Destroys the hash map.
  * 
@@ -0,0 +1,256 @@
+#include "mapped_hash_map.h"
+#include "../hash_map/hash_map.h"
+
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/** "MHMAP\0\0\1", also catches files written with a different layout version. */
+#define MHM_MAGIC 0x4d484d4150000001ull
+#define MHM_ALIGN_UP(n) (((n) + 7) & ~(uint64_t)7)
+#define MHM_ENTRY(map, index) ((struct mhm_entry *)((char *)(map)->entries + ((index) * (map)->header->entry_size)))
+#define MHM_KEY(map, entry) ((void *)((char *)(entry) + (map)->header->key_offset))
+#define MHM_VALUE(map, entry) ((void *)((char *)(entry) + (map)->header->value_offset))
+
+/**
+ * @struct mhm_entry
+ * @brief  Header of an inline entry, the key and value follow it.
+ */
+struct mhm_entry {
+    /** Full hash of the key. */
+    uint64_t hash;
+    /** Non-zero if occupied, fixed width so the layout is the same in every process. */
+    uint64_t occupied;
+};
+
+bool mhm_create(const char *path, const size_t key_size, const size_t value_size, const size_t capacity, struct mapped_hash_map *map)
+{
+    if (!path || key_size == 0 || value_size == 0 || capacity == 0 || !map) {
+        return false;
+    }
+
+    // Room for `capacity` entries below the 0.7 load limit.
+    uint64_t table_capacity = 1;
+    while (table_capacity * 7 / 10 < capacity) {
+        table_capacity <<= 1;
+    }
+
+    const uint64_t key_offset = MHM_ALIGN_UP(sizeof(struct mhm_entry));
+    const uint64_t value_offset = key_offset + MHM_ALIGN_UP(key_size);
+    const uint64_t entry_size = value_offset + MHM_ALIGN_UP(value_size);
+    const size_t mapped_size = sizeof(struct mhm_header) + table_capacity * entry_size;
+
+    // Built next to `path`, so mhm_close can rename it over `path` on the same file system.
+    static const char suffix[] = ".tmp.XXXXXX";
+    const size_t path_length = strlen(path);
+    char *owned_path = malloc(path_length + 1);
+    char *temp_path = malloc(path_length + sizeof(suffix));
+    if (!owned_path || !temp_path) {
+        free(owned_path);
+        free(temp_path);
+        return false;
+    }
+    memcpy(owned_path, path, path_length + 1);
+    memcpy(temp_path, path, path_length);
+    memcpy(temp_path + path_length, suffix, sizeof(suffix));
+
+    const int fd = mkstemp(temp_path);
+    if (fd < 0) {
+        free(owned_path);
+        free(temp_path);
+        return false;
+    }
+
+    // A fresh file reads as zeroes, so every entry starts unoccupied.
+    void *region = MAP_FAILED;
+    if (fchmod(fd, 0644) == 0 && ftruncate(fd, (off_t)mapped_size) == 0) {
+        region = mmap(NULL, mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (region == MAP_FAILED) {
+        unlink(temp_path);
+        free(owned_path);
+        free(temp_path);
+        return false;
+    }
+
+    map->header = region;
+    map->entries = (char *)region + sizeof(struct mhm_header);
+    map->mapped_size = mapped_size;
+    map->writable = true;
+    map->path = owned_path;
+    map->temp_path = temp_path;
+
+    map->header->key_size = key_size;
+    map->header->value_size = value_size;
+    map->header->entry_size = entry_size;
+    map->header->key_offset = key_offset;
+    map->header->value_offset = value_offset;
+    map->header->capacity = table_capacity;
+    map->header->size = 0;
+    // The magic stays zero until mhm_close, so the file is never valid before it is complete.
+    map->header->magic = 0;
+
+    return true;
+}
+
+/**
+ * @brief Checks that a field of `size` bytes at `offset` fits inside an entry after its header.
+ * 
+ * @param[in] offset     Offset of the field inside an entry.
+ * @param[in] size       Size of the field.
+ * @param[in] entry_size Size of an entry.
+ * 
+ * @return true if the field is inside the entry, false otherwise.
+ */
+static bool mhm_field_fits(const uint64_t offset, const uint64_t size, const uint64_t entry_size)
+{
+    // Written as subtractions so a hostile offset or size cannot wrap around.
+    return offset >= sizeof(struct mhm_entry) && offset % 8 == 0
+        && size <= entry_size && offset <= entry_size - size;
+}
+
+bool mhm_open(const char *path, const size_t key_size, const size_t value_size, struct mapped_hash_map *map)
+{
+    if (!path || key_size == 0 || value_size == 0 || !map) {
+        return false;
+    }
+
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(struct mhm_header)) {
+        close(fd);
+        return false;
+    }
+
+    void *region = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (region == MAP_FAILED) {
+        return false;
+    }
+
+    // Nothing in the file is trusted, every size and offset mhm_get relies on is checked.
+    const struct mhm_header *header = region;
+    const bool valid = header->magic == MHM_MAGIC
+        && header->key_size == key_size && header->value_size == value_size
+        && header->entry_size != 0 && header->entry_size % 8 == 0
+        && mhm_field_fits(header->key_offset, header->key_size, header->entry_size)
+        && mhm_field_fits(header->value_offset, header->value_size, header->entry_size)
+        && (header->key_offset + header->key_size <= header->value_offset
+            || header->value_offset + header->value_size <= header->key_offset)
+        && header->capacity != 0 && (header->capacity & (header->capacity - 1)) == 0
+        && header->capacity <= ((size_t)st.st_size - sizeof(struct mhm_header)) / header->entry_size
+        && header->size <= header->capacity;
+    if (!valid) {
+        munmap(region, (size_t)st.st_size);
+        return false;
+    }
+
+    map->header = region;
+    map->entries = (char *)region + sizeof(struct mhm_header);
+    map->mapped_size = (size_t)st.st_size;
+    map->writable = false;
+    map->path = NULL;
+    map->temp_path = NULL;
+
+    return true;
+}
+
+const void *mhm_get(const struct mapped_hash_map *map, const void *key)
+{
+    if (!map || !map->header || !key) {
+        return NULL;
+    }
+
+    const uint64_t hash = hm_hash_bytes(key, map->header->key_size);
+    const uint64_t mask = map->header->capacity - 1;
+
+    for (uint64_t i = 0; i < map->header->capacity; i++) {
+        struct mhm_entry *entry = MHM_ENTRY(map, (hash + i) & mask);
+
+        if (!entry->occupied) {
+            return NULL;
+        }
+
+        if (entry->hash == hash && memcmp(MHM_KEY(map, entry), key, map->header->key_size) == 0) {
+            return MHM_VALUE(map, entry);
+        }
+    }
+
+    return NULL;
+}
+
+bool mhm_insert(struct mapped_hash_map *map, const void *key, const void *value)
+{
+    if (!map || !map->header || !map->writable || !key || !value) {
+        return false;
+    }
+
+    const uint64_t hash = hm_hash_bytes(key, map->header->key_size);
+    const uint64_t mask = map->header->capacity - 1;
+
+    for (uint64_t i = 0; i < map->header->capacity; i++) {
+        struct mhm_entry *entry = MHM_ENTRY(map, (hash + i) & mask);
+
+        if (!entry->occupied) {
+            if (map->header->size >= map->header->capacity * 7 / 10) {
+                return false;
+            }
+            entry->hash = hash;
+            memcpy(MHM_KEY(map, entry), key, map->header->key_size);
+            memcpy(MHM_VALUE(map, entry), value, map->header->value_size);
+            entry->occupied = 1;
+            map->header->size++;
+            return true;
+        }
+
+        if (entry->hash == hash && memcmp(MHM_KEY(map, entry), key, map->header->key_size) == 0) {
+            memcpy(MHM_VALUE(map, entry), value, map->header->value_size);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void mhm_close(struct mapped_hash_map *map)
+{
+    if (!map || !map->header) {
+        return;
+    }
+
+    if (map->writable) {
+        // Entries reach the file before the magic, which marks the table complete.
+        msync(map->header, map->mapped_size, MS_SYNC);
+        atomic_thread_fence(memory_order_release);
+        map->header->magic = MHM_MAGIC;
+        msync(map->header, sizeof(struct mhm_header), MS_SYNC);
+    }
+
+    munmap(map->header, map->mapped_size);
+
+    if (map->writable) {
+        // Atomic swap of the directory entry, existing mappers keep the old inode.
+        if (rename(map->temp_path, map->path) != 0) {
+            unlink(map->temp_path);
+        }
+        free(map->path);
+        free(map->temp_path);
+    }
+
+    map->header = NULL;
+    map->entries = NULL;
+    map->mapped_size = 0;
+    map->writable = false;
+    map->path = NULL;
+    map->temp_path = NULL;
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * @struct mhm_header
+ * @brief  Start of the mapped region, describes the table that follows it.
+ *
+ * Only fixed width fields and offsets, never pointers, so every process can map
+ * the region at a different address.
+ */
+struct mhm_header {
+    /** MHM_MAGIC, identifies a valid table. */
+    uint64_t magic;
+    /** Key's size. */
+    uint64_t key_size;
+    /** Value's size. */
+    uint64_t value_size;
+    /** Size of a single inline entry (header, key and value). */
+    uint64_t entry_size;
+    /** Offset of the key inside an entry. */
+    uint64_t key_offset;
+    /** Offset of the value inside an entry. */
+    uint64_t value_offset;
+    /** Capacity of the table, always a power of two. */
+    uint64_t capacity;
+    /** Current number of entries. */
+    uint64_t size;
+};
+
+/**
+ * @struct mapped_hash_map
+ * @brief  Position independent hash map living in a memory mapped file.
+ *
+ * One process builds the table with mhm_create and mhm_insert, others map the same
+ * file read-only with mhm_open and look keys up with no deserialization. A file on
+ * a tmpfs such as /dev/shm gives a POSIX shared memory segment.
+ *
+ * Keys are hashed with hm_hash_bytes and compared bytewise, since function
+ * pointers cannot be shared between processes.
+ */
+struct mapped_hash_map {
+    /** Header at the start of the mapping. */
+    struct mhm_header *header;
+    /** Inline entries following the header. */
+    void *entries;
+    /** Size of the mapping. */
+    size_t mapped_size;
+    /** Whether the mapping was created writable by mhm_create. */
+    bool writable;
+    /** Path the table is published to by mhm_close, NULL if read-only. */
+    char *path;
+    /** Temporary file being built next to `path`, NULL if read-only. */
+    char *temp_path;
+};
+
+/**
+ * @brief Creates a table file and maps it read-write for building.
+ * 
+ * The table is built in a temporary file in the same directory and only replaces
+ * `path` in mhm_close, so processes that still map an older table keep reading it
+ * and mhm_open never sees a half built one.
+ * 
+ * @param[in]  path       Path of the file, replaced by mhm_close if it exists.
+ * @param[in]  key_size   Key's size.
+ * @param[in]  value_size Value's size.
+ * @param[in]  capacity   Maximum number of entries, the table is sized for it up front.
+ * @param[out] map        Pointer to caller allocated mapped_hash_map struct.
+ * 
+ * @return true if successful, false otherwise.
+ */
+bool mhm_create(const char *path, const size_t key_size, const size_t value_size, const size_t capacity, struct mapped_hash_map *map);
+/**
+ * @brief Maps an already built table file read-only.
+ * 
+ * Every size and offset in the header is validated, so a truncated, unfinished or
+ * corrupt file is rejected instead of read out of bounds.
+ * 
+ * @param[in]  path       Path of the file.
+ * @param[in]  key_size   Key's size the table must have been created with.
+ * @param[in]  value_size Value's size the table must have been created with.
+ * @param[out] map        Pointer to caller allocated mapped_hash_map struct.
+ * 
+ * @return true if the file holds a valid table, false otherwise.
+ */
+bool mhm_open(const char *path, const size_t key_size, const size_t value_size, struct mapped_hash_map *map);
+/**
+ * @brief Gets value from its key.
+ * 
+ * @param[in] map Pointer to mapped_hash_map struct.
+ * @param[in] key Key to search, `key_size` bytes.
+ * 
+ * @return Pointer to the value inside the mapping if found, NULL otherwise.
+ */
+const void *mhm_get(const struct mapped_hash_map *map, const void *key);
+/**
+ * @brief Inserts a key into a table mapped by mhm_create, overwriting the value if it exists.
+ * 
+ * @param[in] map   Pointer to mapped_hash_map struct.
+ * @param[in] key   Key to insert, `key_size` bytes.
+ * @param[in] value Value to insert, `value_size` bytes.
+ * 
+ * @return true if successful, false if the table is full or read-only.
+ */
+bool mhm_insert(struct mapped_hash_map *map, const void *key, const void *value);
+/**
+ * @brief Unmaps the table.
+ *        A table being built is flushed, marked valid and renamed over its path first.
+ * 
+ * @param[in] map Pointer to mapped_hash_map struct.
+ */
+void mhm_close(struct mapped_hash_map *map);
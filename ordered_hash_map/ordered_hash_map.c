@@ -0,0 +1,278 @@
+#include "ordered_hash_map.h"
+
+#include <string.h>
+
+/** Index slot that was never used. */
+#define OHM_EMPTY (-1)
+/** Index slot whose entry was deleted, probing continues past it. */
+#define OHM_DUMMY (-2)
+
+#define OHM_ALIGN_UP(n) (((n) + 7) & ~(size_t)7)
+#define OHM_ENTRY(map, position) ((struct ohm_entry *)((char *)(map)->entries + ((position) * (map)->entry_size)))
+#define OHM_KEY(map, entry) ((void *)((char *)(entry) + (map)->key_offset))
+#define OHM_VALUE(map, entry) ((void *)((char *)(entry) + (map)->value_offset))
+
+/**
+ * @brief Fills a new index table from the live entries and installs it.
+ * 
+ * @param[in] map            Pointer to ordered_hash_map struct, entries already compacted.
+ * @param[in] indices        New index table of `index_capacity` slots.
+ * @param[in] index_capacity Capacity of the new index table, a power of two.
+ */
+static void ohm_build_indices(struct ordered_hash_map *map, int32_t *indices, const size_t index_capacity)
+{
+    // All bytes 0xff is OHM_EMPTY.
+    memset(indices, 0xff, index_capacity * sizeof(int32_t));
+
+    const size_t mask = index_capacity - 1;
+    for (size_t position = 0; position < map->used; position++) {
+        size_t slot = (size_t)OHM_ENTRY(map, position)->hash & mask;
+        while (indices[slot] != OHM_EMPTY) {
+            slot = (slot + 1) & mask;
+        }
+        indices[slot] = (int32_t)position;
+    }
+
+    free(map->indices);
+    map->indices = indices;
+    map->index_capacity = index_capacity;
+}
+
+void ohm_init(const size_t key_size, const size_t value_size, const size_t capacity, const hash_func hash, const cmp_func cmp, struct ordered_hash_map *map)
+{
+    if (!map) {
+        return;
+    }
+
+    // Every field is valid for ohm_destroy even if initialization fails below.
+    memset(map, 0, sizeof(*map));
+
+    if (key_size == 0 || value_size == 0 || capacity == 0 || !cmp) {
+        return;
+    }
+
+    // Entries fill at most 2/3 of the index table.
+    size_t index_capacity = 8;
+    while (index_capacity * 2 / 3 < capacity) {
+        index_capacity <<= 1;
+    }
+
+    map->key_size = key_size;
+    map->value_size = value_size;
+    map->key_offset = OHM_ALIGN_UP(sizeof(struct ohm_entry));
+    map->value_offset = map->key_offset + OHM_ALIGN_UP(key_size);
+    map->entry_size = map->value_offset + OHM_ALIGN_UP(value_size);
+    map->hash = hash ? hash : hm_hash_bytes;
+    map->cmp = cmp;
+    map->used = 0;
+    map->size = 0;
+    map->indices = NULL;
+    map->index_capacity = 0;
+    map->entry_capacity = index_capacity * 2 / 3;
+
+    map->entries = malloc(map->entry_capacity * map->entry_size);
+    int32_t *indices = malloc(index_capacity * sizeof(int32_t));
+    if (!map->entries || !indices) {
+        free(map->entries);
+        map->entries = NULL;
+        free(indices);
+        map->entry_capacity = 0;
+        return;
+    }
+
+    ohm_build_indices(map, indices, index_capacity);
+}
+
+/**
+ * @brief Finds the index slot pointing at a key.
+ * 
+ * @param[in]  map       Pointer to ordered_hash_map struct.
+ * @param[in]  key       Key to search.
+ * @param[in]  hash      Hash of the key.
+ * @param[out] free_slot Optional, set to the first reusable slot of the probe chain.
+ * 
+ * @return Index slot if found, SIZE_MAX otherwise.
+ */
+static size_t ohm_lookup(const struct ordered_hash_map *map, const void *key, const uint64_t hash, size_t *free_slot)
+{
+    const size_t mask = map->index_capacity - 1;
+    size_t first_free = SIZE_MAX;
+
+    for (size_t slot = (size_t)hash & mask; ; slot = (slot + 1) & mask) {
+        const int32_t position = map->indices[slot];
+
+        if (position == OHM_EMPTY) {
+            if (free_slot) {
+                *free_slot = first_free != SIZE_MAX ? first_free : slot;
+            }
+            return SIZE_MAX;
+        }
+
+        if (position == OHM_DUMMY) {
+            if (first_free == SIZE_MAX) {
+                first_free = slot;
+            }
+            continue;
+        }
+
+        struct ohm_entry *entry = OHM_ENTRY(map, (size_t)position);
+        if (entry->hash == hash && map->cmp(OHM_KEY(map, entry), key) == 0) {
+            return slot;
+        }
+    }
+}
+
+void *ohm_get(const struct ordered_hash_map *map, const void *key)
+{
+    if (!map || !map->indices || !key) {
+        return NULL;
+    }
+
+    const size_t slot = ohm_lookup(map, key, map->hash(key, map->key_size), NULL);
+    if (slot == SIZE_MAX) {
+        return NULL;
+    }
+
+    return OHM_VALUE(map, OHM_ENTRY(map, (size_t)map->indices[slot]));
+}
+
+/**
+ * @brief Squeezes out holes left by deletes and rebuilds the index table.
+ *
+ * Live entries only move towards the front, so insertion order is kept.
+ * 
+ * @param[in] map            Pointer to ordered_hash_map struct.
+ * @param[in] index_capacity Capacity of the new index table, a power of two.
+ */
+static void ohm_resize(struct ordered_hash_map *map, const size_t index_capacity)
+{
+    const size_t entry_capacity = index_capacity * 2 / 3;
+    if (entry_capacity > INT32_MAX) {
+        return;
+    }
+
+    // Allocate up front, so a failure leaves the map untouched.
+    int32_t *indices = malloc(index_capacity * sizeof(int32_t));
+    if (!indices) {
+        return;
+    }
+
+    if (entry_capacity > map->entry_capacity) {
+        void *entries = realloc(map->entries, entry_capacity * map->entry_size);
+        if (!entries) {
+            free(indices);
+            return;
+        }
+        map->entries = entries;
+        map->entry_capacity = entry_capacity;
+    }
+
+    size_t live = 0;
+    for (size_t position = 0; position < map->used; position++) {
+        struct ohm_entry *entry = OHM_ENTRY(map, position);
+        if (!entry->live) {
+            continue;
+        }
+        if (live != position) {
+            memcpy(OHM_ENTRY(map, live), entry, map->entry_size);
+        }
+        live++;
+    }
+    map->used = live;
+
+    ohm_build_indices(map, indices, index_capacity);
+}
+
+void ohm_insert(struct ordered_hash_map *map, const void *key, const void *value)
+{
+    if (!map || !map->indices || !key || !value) {
+        return;
+    }
+
+    const uint64_t hash = map->hash(key, map->key_size);
+    size_t free_slot = SIZE_MAX;
+
+    size_t slot = ohm_lookup(map, key, hash, &free_slot);
+    if (slot != SIZE_MAX) {
+        memcpy(OHM_VALUE(map, OHM_ENTRY(map, (size_t)map->indices[slot])), value, map->value_size);
+        return;
+    }
+
+    if (map->used == map->entry_capacity) {
+        // Mostly holes: compact at the same size, otherwise grow.
+        ohm_resize(map, map->size * 2 >= map->entry_capacity ? map->index_capacity * 2 : map->index_capacity);
+        if (map->used == map->entry_capacity) {
+            return;
+        }
+        ohm_lookup(map, key, hash, &free_slot);
+    }
+
+    struct ohm_entry *entry = OHM_ENTRY(map, map->used);
+    entry->hash = hash;
+    entry->live = true;
+    memcpy(OHM_KEY(map, entry), key, map->key_size);
+    memcpy(OHM_VALUE(map, entry), value, map->value_size);
+
+    map->indices[free_slot] = (int32_t)map->used;
+    map->used++;
+    map->size++;
+}
+
+void ohm_delete(struct ordered_hash_map *map, const void *key)
+{
+    if (!map || !map->indices || !key) {
+        return;
+    }
+
+    const size_t slot = ohm_lookup(map, key, map->hash(key, map->key_size), NULL);
+    if (slot == SIZE_MAX) {
+        return;
+    }
+
+    OHM_ENTRY(map, (size_t)map->indices[slot])->live = false;
+    map->indices[slot] = OHM_DUMMY;
+    map->size--;
+}
+
+bool ohm_next(const struct ordered_hash_map *map, size_t *position, void **key, void **value)
+{
+    if (!map || !position) {
+        return false;
+    }
+
+    while (*position < map->used) {
+        struct ohm_entry *entry = OHM_ENTRY(map, *position);
+        (*position)++;
+
+        if (!entry->live) {
+            continue;
+        }
+
+        if (key) {
+            *key = OHM_KEY(map, entry);
+        }
+        if (value) {
+            *value = OHM_VALUE(map, entry);
+        }
+        return true;
+    }
+
+    return false;
+}
+
+void ohm_destroy(struct ordered_hash_map *map)
+{
+    if (!map) {
+        return;
+    }
+
+    free(map->indices);
+    map->indices = NULL;
+    free(map->entries);
+    map->entries = NULL;
+    map->index_capacity = 0;
+    map->entry_capacity = 0;
+    map->used = 0;
+    map->size = 0;
+    map->cmp = NULL;
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "../hash_map/hash_map.h"
+
+/**
+ * @struct ohm_entry
+ * @brief  Header of an entry in the dense array, the key and value follow inline.
+ */
+struct ohm_entry {
+    /** Full hash of the key. */
+    uint64_t hash;
+    /** Whether the entry is still in the map, deleted ones are holes until the next resize. */
+    bool live;
+};
+
+/**
+ * @struct ordered_hash_map
+ * @brief  Compact hash map that keeps insertion order.
+ *
+ * Entries are appended to a dense array, the hash table itself is a small array of
+ * int32_t positions into it. Iterating walks the dense array in insertion order and
+ * a resize only rebuilds the positions.
+ */
+struct ordered_hash_map {
+    /** Hash table of positions into `entries`, OHM_EMPTY or OHM_DUMMY if unused. */
+    int32_t *indices;
+    /** Capacity of `indices`, always a power of two. */
+    size_t index_capacity;
+    /** Dense, append-only array of inline entries. */
+    void *entries;
+    /** Number of entries `entries` has room for, 2/3 of `index_capacity`. */
+    size_t entry_capacity;
+    /** Number of appended entries, including holes left by deletes. */
+    size_t used;
+    /** Current size of the map. */
+    size_t size;
+    /** Key's size. */
+    size_t key_size;
+    /** Value's size. */
+    size_t value_size;
+    /** Size of a single entry (header, key and value). */
+    size_t entry_size;
+    /** Offset of the key inside an entry. */
+    size_t key_offset;
+    /** Offset of the value inside an entry. */
+    size_t value_offset;
+    /** Hash function for the keys. */
+    hash_func hash;
+    /** Custom comparasion function for comparing keys. */
+    cmp_func cmp;
+};
+
+/**
+ * @brief Initializes the ordered hash map.
+ *        Every field is zeroed first, so ohm_destroy is safe even if `indices` stays NULL.
+ * 
+ * @param[in]  key_size   Key's size.
+ * @param[in]  value_size Value's size.
+ * @param[in]  capacity   Initial number of entries to make room for.
+ * @param[in]  hash       Hash function for the keys, NULL for hm_hash_bytes.
+ * @param[in]  cmp        Custom comparision function used for comparing keys.
+ * @param[out] map        Pointer to caller allocated ordered_hash_map struct.
+ */
+void ohm_init(const size_t key_size, const size_t value_size, const size_t capacity, const hash_func hash, const cmp_func cmp, struct ordered_hash_map *map);
+/**
+ * @brief Gets value from its key.
+ * 
+ * @param[in] map Pointer to ordered_hash_map struct.
+ * @param[in] key Key to search.
+ * 
+ * @return Key's value if found, NULL otherwise. Valid until the next insert or delete.
+ */
+void *ohm_get(const struct ordered_hash_map *map, const void *key);
+/**
+ * @brief Inserts a key at the end of the order, or overwrites its value in place if it exists.
+ * 
+ * @param[in] map   Pointer to ordered_hash_map struct.
+ * @param[in] key   Key to insert.
+ * @param[in] value Value to insert.
+ */
+void ohm_insert(struct ordered_hash_map *map, const void *key, const void *value);
+/**
+ * @brief Deletes an entry in the ordered hash map.
+ * 
+ * @param[in] map Pointer to ordered_hash_map struct.
+ * @param[in] key Key to delete.
+ */
+void ohm_delete(struct ordered_hash_map *map, const void *key);
+/**
+ * @brief Iterates the entries in insertion order.
+ *
+ * Start with `*position` set to 0 and call until it returns false.
+ * The map must not be modified while iterating.
+ * 
+ * @param[in]     map      Pointer to ordered_hash_map struct.
+ * @param[in,out] position Iteration cursor.
+ * @param[out]    key      Optional pointer set to the entry's key.
+ * @param[out]    value    Optional pointer set to the entry's value.
+ * 
+ * @return true if an entry was returned, false once all were visited.
+ */
+bool ohm_next(const struct ordered_hash_map *map, size_t *position, void **key, void **value);
+/**
+ * @brief Destroys the ordered hash map.
+ * 
+ * @param[in] map Pointer to ordered_hash_map struct.
+ */
+void ohm_destroy(struct ordered_hash_map *map);
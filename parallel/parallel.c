@@ -0,0 +1,418 @@
+#include "parallel.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+/** Smallest chunk worth handing to another thread, in bytes of elements. */
+#define PAR_MIN_CHUNK_BYTES (16 * 1024)
+/** Chunks per thread aimed for, so threads that finish early can take over work. */
+#define PAR_CHUNKS_PER_THREAD 4
+
+#define PAR_ELEMENT(span, index) ((char *)(span).items + ((index) * (span).e_size))
+
+/** Set while the thread runs a chunk, par_run then runs nested jobs inline. */
+static _Thread_local bool par_in_job;
+
+/**
+ * @brief Runs chunks of the current job until none are left.
+ */
+static void par_drain(struct par_pool *pool, const par_job_func job, void *ctx, const size_t chunk_count)
+{
+    par_in_job = true;
+    for (;;) {
+        const size_t chunk = atomic_fetch_add_explicit(&pool->next_chunk, 1, memory_order_relaxed);
+        if (chunk >= chunk_count) {
+            break;
+        }
+        job(chunk, ctx);
+    }
+    par_in_job = false;
+}
+
+static void *par_worker(void *arg)
+{
+    struct par_pool *pool = arg;
+    size_t seen = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->stop && pool->generation == seen) {
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        }
+        if (pool->stop) {
+            break;
+        }
+
+        seen = pool->generation;
+        const par_job_func job = pool->job;
+        void *ctx = pool->ctx;
+        const size_t chunk_count = pool->chunk_count;
+        pthread_mutex_unlock(&pool->lock);
+
+        par_drain(pool, job, ctx, chunk_count);
+
+        pthread_mutex_lock(&pool->lock);
+        pool->finished++;
+        pthread_cond_signal(&pool->done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+bool par_pool_init(const size_t thread_count, struct par_pool *pool)
+{
+    if (!pool) {
+        return false;
+    }
+
+    size_t count = thread_count;
+    if (count == 0) {
+        const long online = sysconf(_SC_NPROCESSORS_ONLN);
+        count = online > 0 ? (size_t)online : 1;
+    }
+
+    pool->thread_count = 0;
+    pool->generation = 0;
+    pool->finished = 0;
+    pool->stop = false;
+    pool->job = NULL;
+    pool->ctx = NULL;
+    pool->chunk_count = 0;
+    atomic_init(&pool->next_chunk, 0);
+
+    pool->threads = malloc((count - 1 ? count - 1 : 1) * sizeof(pthread_t));
+    if (!pool->threads) {
+        return false;
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_mutex_init(&pool->submit, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    for (size_t i = 0; i + 1 < count; i++) {
+        if (pthread_create(&pool->threads[i], NULL, par_worker, pool) != 0) {
+            par_pool_destroy(pool);
+            return false;
+        }
+        pool->thread_count++;
+    }
+
+    return true;
+}
+
+void par_run(struct par_pool *pool, const size_t chunk_count, const par_job_func job, void *ctx)
+{
+    if (!pool || !job || chunk_count == 0) {
+        return;
+    }
+
+    if (par_in_job) {
+        // Called from a chunk, the pool is busy with the outer job and waiting for it would deadlock.
+        for (size_t i = 0; i < chunk_count; i++) {
+            job(i, ctx);
+        }
+        return;
+    }
+
+    pthread_mutex_lock(&pool->submit);
+
+    if (pool->thread_count == 0 || chunk_count == 1) {
+        // Not worth waking anyone.
+        par_in_job = true;
+        for (size_t i = 0; i < chunk_count; i++) {
+            job(i, ctx);
+        }
+        par_in_job = false;
+        pthread_mutex_unlock(&pool->submit);
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->job = job;
+    pool->ctx = ctx;
+    pool->chunk_count = chunk_count;
+    atomic_store_explicit(&pool->next_chunk, 0, memory_order_relaxed);
+    pool->finished = 0;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    par_drain(pool, job, ctx, chunk_count);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->finished < pool->thread_count) {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    pthread_mutex_unlock(&pool->submit);
+}
+
+/**
+ * @brief Picks the chunk size for a span.
+ *
+ * About PAR_CHUNKS_PER_THREAD chunks per thread, but no chunk below
+ * PAR_MIN_CHUNK_BYTES, where handing it over would cost more than running it.
+ *
+ * @return Number of elements per chunk, at least 1.
+ */
+static size_t par_grain(const struct par_pool *pool, const struct par_span span)
+{
+    const size_t min_grain = PAR_MIN_CHUNK_BYTES / span.e_size ? PAR_MIN_CHUNK_BYTES / span.e_size : 1;
+    const size_t grain = span.size / ((pool->thread_count + 1) * PAR_CHUNKS_PER_THREAD);
+    return grain > min_grain ? grain : min_grain;
+}
+
+/**
+ * @struct par_task
+ * @brief  Shared state of one parallel algorithm call.
+ */
+struct par_task {
+    /** Input elements. */
+    struct par_span in;
+    /** Output elements, or scratch space while sorting. */
+    struct par_span out;
+    /** Elements per chunk. */
+    size_t grain;
+    /** User function of the algorithm. */
+    union {
+        par_each_func each;
+        par_transform_func transform;
+        par_combine_func combine;
+        par_cmp_func cmp;
+    } fn;
+    /** User context. */
+    void *ctx;
+    /** Element leaving others unchanged, for par_reduce. */
+    const void *identity;
+    /** Chunks per run being merged, for par_sort. */
+    size_t width;
+};
+
+/**
+ * @brief Gets the element range of a chunk.
+ */
+static void par_chunk_range(const struct par_task *task, const size_t chunk, size_t *first, size_t *last)
+{
+    *first = chunk * task->grain;
+    *last = *first + task->grain < task->in.size ? *first + task->grain : task->in.size;
+}
+
+static size_t par_chunk_count(const struct par_task *task)
+{
+    return (task->in.size + task->grain - 1) / task->grain;
+}
+
+static void par_for_each_job(const size_t chunk, void *ctx)
+{
+    const struct par_task *task = ctx;
+    size_t first, last;
+    par_chunk_range(task, chunk, &first, &last);
+
+    for (size_t i = first; i < last; i++) {
+        task->fn.each(PAR_ELEMENT(task->in, i), i, task->ctx);
+    }
+}
+
+bool par_for_each(struct par_pool *pool, const struct par_span span, const par_each_func fn, void *ctx)
+{
+    if (!pool || !span.items || span.e_size == 0 || !fn) {
+        return false;
+    }
+
+    if (span.size == 0) {
+        return true;
+    }
+
+    struct par_task task = {.in = span, .grain = par_grain(pool, span), .ctx = ctx};
+    task.fn.each = fn;
+    par_run(pool, par_chunk_count(&task), par_for_each_job, &task);
+    return true;
+}
+
+static void par_transform_job(const size_t chunk, void *ctx)
+{
+    const struct par_task *task = ctx;
+    size_t first, last;
+    par_chunk_range(task, chunk, &first, &last);
+
+    for (size_t i = first; i < last; i++) {
+        task->fn.transform(PAR_ELEMENT(task->in, i), PAR_ELEMENT(task->out, i), task->ctx);
+    }
+}
+
+bool par_transform(struct par_pool *pool, const struct par_span in, const struct par_span out, const par_transform_func fn, void *ctx)
+{
+    if (!pool || !in.items || !out.items || in.e_size == 0 || out.e_size == 0 || out.size < in.size || !fn) {
+        return false;
+    }
+
+    if (in.size == 0) {
+        return true;
+    }
+
+    // Chunks run in any order, so an output element may only overlap its own input element.
+    const uintptr_t in_first = (uintptr_t)in.items;
+    const uintptr_t out_first = (uintptr_t)out.items;
+    const bool overlap = in_first < out_first + in.size * out.e_size && out_first < in_first + in.size * in.e_size;
+    if (overlap && (in_first != out_first || in.e_size != out.e_size)) {
+        return false;
+    }
+
+    // Sized by the larger element, both spans are touched per element.
+    const struct par_span sizing = {in.items, in.size, in.e_size > out.e_size ? in.e_size : out.e_size};
+    struct par_task task = {.in = in, .out = out, .grain = par_grain(pool, sizing), .ctx = ctx};
+    task.fn.transform = fn;
+    par_run(pool, par_chunk_count(&task), par_transform_job, &task);
+    return true;
+}
+
+static void par_reduce_job(const size_t chunk, void *ctx)
+{
+    const struct par_task *task = ctx;
+    size_t first, last;
+    par_chunk_range(task, chunk, &first, &last);
+
+    void *acc = PAR_ELEMENT(task->out, chunk);
+    memcpy(acc, task->identity, task->in.e_size);
+    for (size_t i = first; i < last; i++) {
+        task->fn.combine(acc, PAR_ELEMENT(task->in, i), task->ctx);
+    }
+}
+
+bool par_reduce(struct par_pool *pool, const struct par_span span, const void *identity, const par_combine_func combine, void *ctx, void *result)
+{
+    if (!pool || !span.items || span.e_size == 0 || !identity || !combine || !result) {
+        return false;
+    }
+
+    struct par_task task = {.in = span, .grain = par_grain(pool, span), .ctx = ctx, .identity = identity};
+    task.fn.combine = combine;
+    const size_t chunk_count = par_chunk_count(&task);
+
+    // One partial result per chunk, folded in chunk order at the end.
+    task.out.items = malloc((chunk_count ? chunk_count : 1) * span.e_size);
+    task.out.size = chunk_count;
+    task.out.e_size = span.e_size;
+    if (!task.out.items) {
+        return false;
+    }
+
+    par_run(pool, chunk_count, par_reduce_job, &task);
+
+    memcpy(result, identity, span.e_size);
+    for (size_t i = 0; i < chunk_count; i++) {
+        combine(result, PAR_ELEMENT(task.out, i), ctx);
+    }
+
+    free(task.out.items);
+    return true;
+}
+
+static void par_sort_job(const size_t chunk, void *ctx)
+{
+    const struct par_task *task = ctx;
+    size_t first, last;
+    par_chunk_range(task, chunk, &first, &last);
+
+    qsort(PAR_ELEMENT(task->in, first), last - first, task->in.e_size, task->fn.cmp);
+}
+
+/**
+ * @brief Merges two neighbouring sorted runs of `width` chunks from `in` into `out`.
+ */
+static void par_merge_job(const size_t pair, void *ctx)
+{
+    const struct par_task *task = ctx;
+    const size_t size = task->in.size;
+    const size_t e_size = task->in.e_size;
+    const size_t run = task->width * task->grain;
+
+    size_t left = pair * 2 * run;
+    const size_t mid = left + run < size ? left + run : size;
+    const size_t end = mid + run < size ? mid + run : size;
+    size_t right = mid;
+    char *dest = PAR_ELEMENT(task->out, left);
+
+    while (left < mid && right < end) {
+        // Take from the left on ties.
+        const size_t from = task->fn.cmp(PAR_ELEMENT(task->in, right), PAR_ELEMENT(task->in, left)) < 0 ? right++ : left++;
+        memcpy(dest, PAR_ELEMENT(task->in, from), e_size);
+        dest += e_size;
+    }
+
+    memcpy(dest, PAR_ELEMENT(task->in, left), (mid - left) * e_size);
+    dest += (mid - left) * e_size;
+    memcpy(dest, PAR_ELEMENT(task->in, right), (end - right) * e_size);
+}
+
+bool par_sort(struct par_pool *pool, const struct par_span span, const par_cmp_func cmp)
+{
+    if (!pool || !span.items || span.e_size == 0 || !cmp) {
+        return false;
+    }
+
+    if (span.size < 2) {
+        return true;
+    }
+
+    struct par_task task = {.in = span, .grain = par_grain(pool, span)};
+    task.fn.cmp = cmp;
+    const size_t chunk_count = par_chunk_count(&task);
+
+    par_run(pool, chunk_count, par_sort_job, &task);
+    if (chunk_count == 1) {
+        return true;
+    }
+
+    void *scratch = malloc(span.size * span.e_size);
+    if (!scratch) {
+        return false;
+    }
+    task.out = span;
+    task.out.items = scratch;
+
+    // Every round halves the runs, merging pairs of them in parallel.
+    for (task.width = 1; task.width < chunk_count; task.width *= 2) {
+        const size_t pairs = (chunk_count + 2 * task.width - 1) / (2 * task.width);
+        par_run(pool, pairs, par_merge_job, &task);
+
+        void *swap = task.in.items;
+        task.in.items = task.out.items;
+        task.out.items = swap;
+    }
+
+    if (task.in.items != span.items) {
+        memcpy(span.items, task.in.items, span.size * span.e_size);
+    }
+
+    free(scratch);
+    return true;
+}
+
+void par_pool_destroy(struct par_pool *pool)
+{
+    if (!pool || !pool->threads) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = true;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (size_t i = 0; i < pool->thread_count; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_mutex_destroy(&pool->submit);
+    pthread_cond_destroy(&pool->wake);
+    pthread_cond_destroy(&pool->done);
+    free(pool->threads);
+    pool->threads = NULL;
+    pool->thread_count = 0;
+}
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "../array/array.h"
+#include "../vector/vector.h"
+
+/**
+ * @typedef par_each_func
+ * @brief   Visits an element, see par_for_each.
+ * 
+ * @param[in,out] element Element to visit.
+ * @param[in]     index   Index of the element.
+ * @param[in]     ctx     Context given to par_for_each.
+ */
+typedef void (*par_each_func)(void *element, const size_t index, void *ctx);
+
+/**
+ * @typedef par_transform_func
+ * @brief   Computes an output element from an input element, see par_transform.
+ * 
+ * @param[in]  in  Input element.
+ * @param[out] out Output element.
+ * @param[in]  ctx Context given to par_transform.
+ */
+typedef void (*par_transform_func)(const void *in, void *out, void *ctx);
+
+/**
+ * @typedef par_combine_func
+ * @brief   Folds an element into an accumulator, see par_reduce. Must be associative.
+ * 
+ * @param[in,out] acc     Accumulator, of the element's type.
+ * @param[in]     element Element to fold in.
+ * @param[in]     ctx     Context given to par_reduce.
+ */
+typedef void (*par_combine_func)(void *acc, const void *element, void *ctx);
+
+/**
+ * @typedef par_cmp_func
+ * @brief   Compares two elements like qsort's comparator, see par_sort.
+ * 
+ * @return < 0 if a sorts first, 0 if equal, > 0 if b sorts first.
+ */
+typedef int (*par_cmp_func)(const void *a, const void *b);
+
+/**
+ * @struct par_span
+ * @brief  Contiguous elements the algorithms run over, taken from a vector or an array.
+ */
+struct par_span {
+    /** First element. */
+    void *items;
+    /** Number of elements. */
+    size_t size;
+    /** Size of each element. */
+    size_t e_size;
+};
+
+/**
+ * @brief Makes a span of a vector's elements, valid until the vector reallocates.
+ */
+static inline struct par_span par_span_of_vector(const struct vector *vec)
+{
+    const struct par_span span = {vec->items, vec->size, vec->e_size};
+    return span;
+}
+
+/**
+ * @brief Makes a span of an array's elements.
+ */
+static inline struct par_span par_span_of_array(const struct array *arr)
+{
+    const struct par_span span = {arr->items, arr->size, arr->item_size};
+    return span;
+}
+
+/**
+ * @typedef par_job_func
+ * @brief   Runs one chunk of a job on a pool thread.
+ */
+typedef void (*par_job_func)(const size_t chunk, void *ctx);
+
+/**
+ * @struct par_pool
+ * @brief  Fixed set of threads running one job at a time, split into chunks.
+ *
+ * Threads take the next chunk from a shared counter until none are left, so faster
+ * threads take more chunks. The calling thread works on the job as well.
+ *
+ * A par_* call made from inside a chunk, on any pool, runs all of its chunks on
+ * the calling thread instead of waiting for a pool that is busy with the outer job.
+ */
+struct par_pool {
+    /** Background threads. */
+    pthread_t *threads;
+    /** Number of background threads, one less than the pool's threads. */
+    size_t thread_count;
+    /** Protects the job fields and the counters below. */
+    pthread_mutex_t lock;
+    /** Signaled when a job is posted or the pool stops. */
+    pthread_cond_t wake;
+    /** Signaled when a background thread finishes its part of the job. */
+    pthread_cond_t done;
+    /** Serializes callers, a pool runs one job at a time. */
+    pthread_mutex_t submit;
+    /** Current job. */
+    par_job_func job;
+    /** Context of the current job. */
+    void *ctx;
+    /** Number of chunks of the current job. */
+    size_t chunk_count;
+    /** Next chunk to run. */
+    atomic_size_t next_chunk;
+    /** Incremented for every job, threads wait for it to change. */
+    size_t generation;
+    /** Background threads done with the current job. */
+    size_t finished;
+    /** Set by par_pool_destroy. */
+    bool stop;
+};
+
+/**
+ * @brief Starts the threads of the pool.
+ * 
+ * @param[in]  thread_count Threads working on each job including the caller, 0 for one per online CPU.
+ * @param[out] pool         Pointer to caller allocated par_pool struct.
+ * 
+ * @return true if successful, false otherwise.
+ */
+bool par_pool_init(const size_t thread_count, struct par_pool *pool);
+/**
+ * @brief Runs a job on the pool and waits for all of its chunks.
+ *        Called from inside a chunk, it runs the chunks inline instead.
+ * 
+ * @param[in] pool        Pointer to par_pool struct.
+ * @param[in] chunk_count Number of chunks, each calls `job` once.
+ * @param[in] job         Function running one chunk.
+ * @param[in] ctx         Context passed to `job`.
+ */
+void par_run(struct par_pool *pool, const size_t chunk_count, const par_job_func job, void *ctx);
+/**
+ * @brief Calls a function on every element.
+ *        Elements are split into chunks sized for the pool and at least a few pages each.
+ * 
+ * @param[in] pool Pointer to par_pool struct.
+ * @param[in] span Elements to visit.
+ * @param[in] fn   Function called on each element, from any pool thread.
+ * @param[in] ctx  Context passed to `fn`.
+ * 
+ * @return true if successful, false otherwise.
+ */
+bool par_for_each(struct par_pool *pool, const struct par_span span, const par_each_func fn, void *ctx);
+/**
+ * @brief Computes `out[i]` from `in[i]` for every element.
+ * 
+ * @param[in] pool Pointer to par_pool struct.
+ * @param[in] in   Input elements.
+ * @param[in] out  Output elements, at least as many as `in`. May be `in` itself if the element
+ *                 sizes are equal, any other overlap with `in` is rejected.
+ * @param[in] fn   Function computing an output element.
+ * @param[in] ctx  Context passed to `fn`.
+ * 
+ * @return true if successful, false otherwise.
+ */
+bool par_transform(struct par_pool *pool, const struct par_span in, const struct par_span out, const par_transform_func fn, void *ctx);
+/**
+ * @brief Folds all elements into one.
+ *        Every chunk is folded starting from `identity`, then the chunk results are
+ *        folded in order, so `combine` must be associative but need not be commutative.
+ * 
+ * @param[in]  pool     Pointer to par_pool struct.
+ * @param[in]  span     Elements to fold.
+ * @param[in]  identity Element leaving any element unchanged when combined with it.
+ * @param[in]  combine  Function folding an element into an accumulator.
+ * @param[in]  ctx      Context passed to `combine`.
+ * @param[out] result   Folded element, `e_size` bytes.
+ * 
+ * @return true if successful, false otherwise.
+ */
+bool par_reduce(struct par_pool *pool, const struct par_span span, const void *identity, const par_combine_func combine, void *ctx, void *result);
+/**
+ * @brief Sorts the elements in place.
+ *        Chunks are sorted with qsort in parallel, then merged pairwise in rounds. Not stable.
+ * 
+ * @param[in] pool Pointer to par_pool struct.
+ * @param[in] span Elements to sort.
+ * @param[in] cmp  Comparison function.
+ * 
+ * @return true if successful, false otherwise.
+ */
+bool par_sort(struct par_pool *pool, const struct par_span span, const par_cmp_func cmp);
+/**
+ * @brief Stops and joins the threads of the pool.
+ * 
+ * @param[in] pool Pointer to par_pool struct.
+ */
+void par_pool_destroy(struct par_pool *pool);
@@ -0,0 +1,412 @@
+#include "rcu_hash_map.h"
+
+#include <string.h>
+
+#define RHM_ALIGN_UP(n) (((n) + 7) & ~(size_t)7)
+#define RHM_KEY(map, node) ((void *)((char *)(node) + (map)->key_offset))
+#define RHM_VALUE(map, node) ((void *)((char *)(node) + (map)->value_offset))
+/** Retired blocks gathered before trying to free them. */
+#define RHM_RECLAIM_BATCH 64
+/** Fraction of the table that may hold tombstones before it is rehashed in place. */
+#define RHM_MAX_TOMBSTONES 0.25
+
+/** Marks a deleted slot, its probe chain stays intact. */
+static struct rhm_node rhm_tombstone;
+#define RHM_TOMBSTONE (&rhm_tombstone)
+
+/**
+ * @struct rhm_reader
+ * @brief  Epoch announced by one reader thread, padded to its own cache line.
+ */
+struct rhm_reader {
+    /** `(epoch << 1) | 1` while inside a get, 0 otherwise. */
+    _Alignas(64) _Atomic uint64_t epoch;
+    /** Whether a thread owns this slot. */
+    atomic_bool in_use;
+};
+
+static struct rhm_reader rhm_readers[RHM_MAX_READERS];
+static _Atomic uint64_t rhm_global_epoch = 1;
+static _Thread_local struct rhm_reader *rhm_self;
+static pthread_key_t rhm_reader_key;
+static pthread_once_t rhm_reader_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief Releases a reader slot when its thread exits.
+ */
+static void rhm_reader_release(void *slot)
+{
+    struct rhm_reader *reader = slot;
+    atomic_store(&reader->epoch, 0);
+    atomic_store(&reader->in_use, false);
+}
+
+static void rhm_reader_key_init(void)
+{
+    pthread_key_create(&rhm_reader_key, rhm_reader_release);
+}
+
+/**
+ * @brief Claims a reader slot for the calling thread, once per thread.
+ * 
+ * @return Pointer to the slot, NULL if all are taken.
+ */
+static struct rhm_reader *rhm_reader_get(void)
+{
+    if (rhm_self) {
+        return rhm_self;
+    }
+
+    pthread_once(&rhm_reader_once, rhm_reader_key_init);
+
+    for (size_t i = 0; i < RHM_MAX_READERS; i++) {
+        bool expected = false;
+        if (atomic_compare_exchange_strong(&rhm_readers[i].in_use, &expected, true)) {
+            rhm_self = &rhm_readers[i];
+            pthread_setspecific(rhm_reader_key, rhm_self);
+            return rhm_self;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Advances the global epoch if every reader inside a get has seen the current one.
+ * 
+ * @return The global epoch afterwards.
+ */
+static uint64_t rhm_try_advance(void)
+{
+    uint64_t epoch = atomic_load(&rhm_global_epoch);
+
+    for (size_t i = 0; i < RHM_MAX_READERS; i++) {
+        const uint64_t announced = atomic_load(&rhm_readers[i].epoch);
+        if ((announced & 1) && (announced >> 1) != epoch) {
+            return epoch;
+        }
+    }
+
+    atomic_compare_exchange_strong(&rhm_global_epoch, &epoch, epoch + 1);
+    return atomic_load(&rhm_global_epoch);
+}
+
+/**
+ * @brief Frees retired blocks no reader can still reference.
+ *
+ * A block retired in epoch e was unlinked before any reader entered epoch e + 1,
+ * so once the global epoch reaches e + 2 every reader that could see it has left.
+ * 
+ * @param[in] map Pointer to rcu_hash_map struct, writer lock held.
+ */
+static void rhm_reclaim(struct rcu_hash_map *map)
+{
+    const uint64_t epoch = rhm_try_advance();
+    struct rhm_retired **link = &map->retired;
+
+    while (*link) {
+        struct rhm_retired *retired = *link;
+        if (retired->epoch + 2 <= epoch) {
+            *link = retired->next;
+            free(retired);
+            map->retired_count--;
+        } else {
+            link = &retired->next;
+        }
+    }
+}
+
+/**
+ * @brief Defers freeing a node or table until readers are done with it.
+ * 
+ * @param[in] map     Pointer to rcu_hash_map struct, writer lock held.
+ * @param[in] retired Header of the unlinked block.
+ */
+static void rhm_retire(struct rcu_hash_map *map, struct rhm_retired *retired)
+{
+    retired->epoch = atomic_load(&rhm_global_epoch);
+    retired->next = map->retired;
+    map->retired = retired;
+    map->retired_count++;
+
+    if (map->retired_count >= RHM_RECLAIM_BATCH) {
+        rhm_reclaim(map);
+    }
+}
+
+/**
+ * @brief Allocates an empty table.
+ * 
+ * @return Pointer to the table, NULL on allocation failure.
+ */
+static struct rhm_table *rhm_table_alloc(const size_t capacity)
+{
+    struct rhm_table *table = calloc(1, sizeof(struct rhm_table) + capacity * sizeof(table->slots[0]));
+    if (!table) {
+        return NULL;
+    }
+
+    table->capacity = capacity;
+    for (size_t i = 0; i < capacity; i++) {
+        atomic_init(&table->slots[i], NULL);
+    }
+
+    return table;
+}
+
+bool rhm_init(const size_t key_size, const size_t value_size, const size_t capacity, const hash_func hash, const cmp_func cmp, struct rcu_hash_map *map)
+{
+    if (key_size == 0 || value_size == 0 || capacity == 0 || !cmp || !map) {
+        return false;
+    }
+
+    // Power of two capacities turn the modulo of every probe step into a mask.
+    size_t rounded = 1;
+    while (rounded < capacity) {
+        rounded <<= 1;
+    }
+
+    struct rhm_table *table = rhm_table_alloc(rounded);
+    if (!table) {
+        return false;
+    }
+
+    if (pthread_mutex_init(&map->write_lock, NULL) != 0) {
+        free(table);
+        return false;
+    }
+
+    atomic_init(&map->table, table);
+    map->key_size = key_size;
+    map->value_size = value_size;
+    map->key_offset = RHM_ALIGN_UP(sizeof(struct rhm_node));
+    map->value_offset = map->key_offset + RHM_ALIGN_UP(key_size);
+    map->node_size = map->value_offset + RHM_ALIGN_UP(value_size);
+    map->size = 0;
+    map->tombstones = 0;
+    map->retired = NULL;
+    map->retired_count = 0;
+    map->hash = hash ? hash : hm_hash_bytes;
+    map->cmp = cmp;
+
+    return true;
+}
+
+/**
+ * @brief Finds the slot holding a key.
+ * 
+ * @param[in]  map   Pointer to rcu_hash_map struct.
+ * @param[in]  table Table to probe.
+ * @param[in]  key   Key to search.
+ * @param[in]  hash  Hash of the key.
+ * @param[out] found Node seen in the slot, reloading the slot could see a newer one.
+ * 
+ * @return Pointer to the slot if found, NULL otherwise.
+ */
+static _Atomic(struct rhm_node *) *rhm_find(const struct rcu_hash_map *map, struct rhm_table *table, const void *key, const uint64_t hash, struct rhm_node **found)
+{
+    const size_t mask = table->capacity - 1;
+
+    for (size_t i = 0; i < table->capacity; i++) {
+        _Atomic(struct rhm_node *) *slot = &table->slots[(hash + i) & mask];
+        struct rhm_node *node = atomic_load_explicit(slot, memory_order_acquire);
+
+        if (!node) {
+            return NULL;
+        }
+
+        if (node != RHM_TOMBSTONE && node->hash == hash && map->cmp(RHM_KEY(map, node), key) == 0) {
+            *found = node;
+            return slot;
+        }
+    }
+
+    return NULL;
+}
+
+bool rhm_get(struct rcu_hash_map *map, const void *key, void *value)
+{
+    if (!map || !key || !value) {
+        return false;
+    }
+
+    const uint64_t hash = map->hash(key, map->key_size);
+    struct rhm_reader *reader = rhm_reader_get();
+
+    if (reader) {
+        atomic_store(&reader->epoch, (atomic_load(&rhm_global_epoch) << 1) | 1);
+        atomic_thread_fence(memory_order_seq_cst);
+    } else {
+        pthread_mutex_lock(&map->write_lock);
+    }
+
+    struct rhm_table *table = atomic_load_explicit(&map->table, memory_order_acquire);
+    struct rhm_node *node = NULL;
+    _Atomic(struct rhm_node *) *slot = rhm_find(map, table, key, hash, &node);
+    if (slot) {
+        memcpy(value, RHM_VALUE(map, node), map->value_size);
+    }
+
+    if (reader) {
+        atomic_store_explicit(&reader->epoch, 0, memory_order_release);
+    } else {
+        pthread_mutex_unlock(&map->write_lock);
+    }
+
+    return slot != NULL;
+}
+
+/**
+ * @brief Publishes a copy of the table without tombstones.
+ *
+ * Nodes are shared between both tables, only the old slot array is retired.
+ * 
+ * @param[in] map          Pointer to rcu_hash_map struct, writer lock held.
+ * @param[in] new_capacity Capacity of the new table, a power of two.
+ */
+static void rhm_resize(struct rcu_hash_map *map, const size_t new_capacity)
+{
+    struct rhm_table *old_table = atomic_load_explicit(&map->table, memory_order_relaxed);
+    struct rhm_table *new_table = rhm_table_alloc(new_capacity);
+    if (!new_table) {
+        return;
+    }
+
+    for (size_t i = 0; i < old_table->capacity; i++) {
+        struct rhm_node *node = atomic_load_explicit(&old_table->slots[i], memory_order_relaxed);
+        if (!node || node == RHM_TOMBSTONE) {
+            continue;
+        }
+
+        size_t probe = node->hash & (new_capacity - 1);
+        while (atomic_load_explicit(&new_table->slots[probe], memory_order_relaxed)) {
+            probe = (probe + 1) & (new_capacity - 1);
+        }
+        atomic_store_explicit(&new_table->slots[probe], node, memory_order_relaxed);
+    }
+
+    atomic_store_explicit(&map->table, new_table, memory_order_release);
+    map->tombstones = 0;
+    rhm_retire(map, &old_table->retired);
+}
+
+void rhm_insert(struct rcu_hash_map *map, const void *key, const void *value)
+{
+    if (!map || !key || !value) {
+        return;
+    }
+
+    struct rhm_node *node = malloc(map->node_size);
+    if (!node) {
+        return;
+    }
+    node->hash = map->hash(key, map->key_size);
+    memcpy(RHM_KEY(map, node), key, map->key_size);
+    memcpy(RHM_VALUE(map, node), value, map->value_size);
+
+    pthread_mutex_lock(&map->write_lock);
+
+    struct rhm_table *table = atomic_load_explicit(&map->table, memory_order_relaxed);
+    if (map->size + map->tombstones >= table->capacity * 0.7) {
+        rhm_resize(map, map->size >= table->capacity * 0.35 ? table->capacity * 2 : table->capacity);
+        table = atomic_load_explicit(&map->table, memory_order_relaxed);
+    }
+
+    const size_t mask = table->capacity - 1;
+    _Atomic(struct rhm_node *) *free_slot = NULL;
+
+    for (size_t i = 0; i < table->capacity; i++) {
+        _Atomic(struct rhm_node *) *slot = &table->slots[(node->hash + i) & mask];
+        struct rhm_node *current = atomic_load_explicit(slot, memory_order_relaxed);
+
+        if (current && current != RHM_TOMBSTONE && current->hash == node->hash && map->cmp(RHM_KEY(map, current), key) == 0) {
+            // Replace the whole node, readers see either the old or the new value.
+            atomic_store_explicit(slot, node, memory_order_release);
+            rhm_retire(map, &current->retired);
+            pthread_mutex_unlock(&map->write_lock);
+            return;
+        }
+
+        if (current == RHM_TOMBSTONE && !free_slot) {
+            free_slot = slot;
+        }
+
+        if (!current) {
+            if (!free_slot) {
+                free_slot = slot;
+            }
+            break;
+        }
+    }
+
+    if (free_slot) {
+        if (atomic_load_explicit(free_slot, memory_order_relaxed) == RHM_TOMBSTONE) {
+            map->tombstones--;
+        }
+        atomic_store_explicit(free_slot, node, memory_order_release);
+        map->size++;
+    } else {
+        free(node);
+    }
+
+    pthread_mutex_unlock(&map->write_lock);
+}
+
+void rhm_delete(struct rcu_hash_map *map, const void *key)
+{
+    if (!map || !key) {
+        return;
+    }
+
+    const uint64_t hash = map->hash(key, map->key_size);
+
+    pthread_mutex_lock(&map->write_lock);
+
+    struct rhm_table *table = atomic_load_explicit(&map->table, memory_order_relaxed);
+    struct rhm_node *node = NULL;
+    _Atomic(struct rhm_node *) *slot = rhm_find(map, table, key, hash, &node);
+    if (slot) {
+        atomic_store_explicit(slot, RHM_TOMBSTONE, memory_order_release);
+        rhm_retire(map, &node->retired);
+        map->size--;
+        map->tombstones++;
+
+        // Otherwise only a growing insert would drop them, and misses would probe ever longer chains.
+        if (map->tombstones >= table->capacity * RHM_MAX_TOMBSTONES) {
+            rhm_resize(map, table->capacity);
+        }
+    }
+
+    pthread_mutex_unlock(&map->write_lock);
+}
+
+void rhm_destroy(struct rcu_hash_map *map)
+{
+    if (!map) {
+        return;
+    }
+
+    struct rhm_table *table = atomic_load_explicit(&map->table, memory_order_relaxed);
+    if (table) {
+        for (size_t i = 0; i < table->capacity; i++) {
+            struct rhm_node *node = atomic_load_explicit(&table->slots[i], memory_order_relaxed);
+            if (node && node != RHM_TOMBSTONE) {
+                free(node);
+            }
+        }
+        free(table);
+    }
+
+    while (map->retired) {
+        struct rhm_retired *next = map->retired->next;
+        free(map->retired);
+        map->retired = next;
+    }
+
+    pthread_mutex_destroy(&map->write_lock);
+    atomic_store_explicit(&map->table, NULL, memory_order_relaxed);
+    map->retired_count = 0;
+    map->size = 0;
+    map->tombstones = 0;
+    map->cmp = NULL;
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "../hash_map/hash_map.h"
+
+/** Maximum number of threads reading at the same time without locking. */
+#define RHM_MAX_READERS 128
+
+/**
+ * @struct rhm_retired
+ * @brief  Header of memory waiting for readers to leave before it is freed.
+ */
+struct rhm_retired {
+    /** Next retired block. */
+    struct rhm_retired *next;
+    /** Global epoch at the time it was retired. */
+    uint64_t epoch;
+};
+
+/**
+ * @struct rhm_node
+ * @brief  Immutable entry, the key and value follow the header inline.
+ */
+struct rhm_node {
+    /** Retirement bookkeeping, only touched once the node is unreachable. */
+    struct rhm_retired retired;
+    /** Full hash of the key. */
+    uint64_t hash;
+};
+
+/**
+ * @struct rhm_table
+ * @brief  Open addressing table of node pointers.
+ */
+struct rhm_table {
+    /** Retirement bookkeeping, only touched once the table is replaced. */
+    struct rhm_retired retired;
+    /** Capacity of the table, always a power of two. */
+    size_t capacity;
+    /** Slots, NULL if empty. Slots never go back to NULL, deletes store a tombstone. */
+    _Atomic(struct rhm_node *) slots[];
+};
+
+/**
+ * @struct rcu_hash_map
+ * @brief  Read-mostly hash map whose gets never lock or wait.
+ *
+ * Writers are serialized by a mutex, build new nodes or tables off to the side
+ * and publish them with a single atomic store. Replaced nodes and tables are
+ * freed through epoch based reclamation once no reader can still see them.
+ */
+struct rcu_hash_map {
+    /** Current table, swapped atomically on resize. */
+    _Atomic(struct rhm_table *) table;
+    /** Key's size. */
+    size_t key_size;
+    /** Value's size. */
+    size_t value_size;
+    /** Offset of the key inside a node. */
+    size_t key_offset;
+    /** Offset of the value inside a node. */
+    size_t value_offset;
+    /** Size of a node, header, key and value. */
+    size_t node_size;
+    /** Current size of the map. Writer only. */
+    size_t size;
+    /** Number of tombstones in the current table. Writer only. */
+    size_t tombstones;
+    /** Memory retired by writers and not freed yet. Writer only. */
+    struct rhm_retired *retired;
+    /** Length of the retired list. Writer only. */
+    size_t retired_count;
+    /** Serializes writers. */
+    pthread_mutex_t write_lock;
+    /** Hash function for the keys. */
+    hash_func hash;
+    /** Custom comparasion function for comparing keys. */
+    cmp_func cmp;
+};
+
+/**
+ * @brief Initializes the map. Not thread-safe.
+ * 
+ * @param[in]  key_size   Key's size.
+ * @param[in]  value_size Value's size.
+ * @param[in]  capacity   Initial capacity of the map, rounded up to a power of two.
+ * @param[in]  hash       Hash function for the keys, NULL for hm_hash_bytes.
+ * @param[in]  cmp        Custom comparision function used for comparing keys.
+ * @param[out] map        Pointer to caller allocated rcu_hash_map struct.
+ * 
+ * @return true if successful, false otherwise.
+ */
+bool rhm_init(const size_t key_size, const size_t value_size, const size_t capacity, const hash_func hash, const cmp_func cmp, struct rcu_hash_map *map);
+/**
+ * @brief Gets value from its key without locking, safe against concurrent writers.
+ *
+ * The value is copied out while the reader is inside its epoch, since the node
+ * may be freed afterwards. A thread's first call claims a reader slot, if all
+ * RHM_MAX_READERS slots are taken it falls back to the writer lock.
+ * 
+ * @param[in]  map   Pointer to rcu_hash_map struct.
+ * @param[in]  key   Key to search.
+ * @param[out] value Pointer to caller allocated buffer of `value_size` bytes.
+ * 
+ * @return true if found, false otherwise.
+ */
+bool rhm_get(struct rcu_hash_map *map, const void *key, void *value);
+/**
+ * @brief Inserts a key into the map, replacing the value if it exists.
+ * 
+ * @param[in] map   Pointer to rcu_hash_map struct.
+ * @param[in] key   Key to insert.
+ * @param[in] value Value to insert.
+ */
+void rhm_insert(struct rcu_hash_map *map, const void *key, const void *value);
+/**
+ * @brief Deletes an entry in the map.
+ *        Rehashes the table in place once a quarter of it holds tombstones.
+ * 
+ * @param[in] map Pointer to rcu_hash_map struct.
+ * @param[in] key Key to delete.
+ */
+void rhm_delete(struct rcu_hash_map *map, const void *key);
+/**
+ * @brief Destroys the map. No reader or writer may be running.
+ * 
+ * @param[in] map Pointer to rcu_hash_map struct.
+ */
+void rhm_destroy(struct rcu_hash_map *map);
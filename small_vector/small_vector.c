@@ -0,0 +1,485 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "small_vector.h"
+
+#define SMALL_VECTOR_ITEMS(vec) ((vec)->heap ? (char *)(vec)->heap : (char *)(vec)->inline_items.bytes)
+#define GET_SMALL_VECTOR_ELEMENT(vec, index) (SMALL_VECTOR_ITEMS(vec) + ((index) * (vec)->e_size))
+
+bool small_vector_initialize(const size_t e_size, struct small_vector *vec)
+{
+    if (!vec) {
+        fprintf(stderr, "vector is null at small_vector_initialize()\n");
+        return false;
+    }
+
+    if (e_size == 0) {
+        fprintf(stderr, "element size is 0 at small_vector_initialize()\n");
+        return false;
+    }
+
+    vec->heap = NULL;
+    vec->e_size = e_size;
+    vec->size = 0;
+    // May be 0 for elements larger than the inline storage, the first push then spills.
+    vec->capacity = SMALL_VECTOR_INLINE_BYTES / e_size;
+
+    return true;
+}
+
+void *small_vector_data(struct small_vector *vec)
+{
+    if (!vec) {
+        fprintf(stderr, "vector is null at small_vector_data()\n");
+        return NULL;
+    }
+
+    return SMALL_VECTOR_ITEMS(vec);
+}
+
+void *small_vector_at(struct small_vector *vec, const size_t index)
+{
+    if (!vec) {
+        fprintf(stderr, "vector is null at small_vector_at()\n");
+        return NULL;
+    }
+
+    if (index >= vec->size) {
+        fprintf(stderr, "index is out of bounds at small_vector_at()\n");
+        return NULL;
+    }
+
+    return GET_SMALL_VECTOR_ELEMENT(vec, index);
+}
+
+void *small_vector_back(struct small_vector *vec)
+{
+    if (!vec) {
+        fprintf(stderr, "vector is null at small_vector_back()\n");
+        return NULL;
+    }
+
+    if (vec->size == 0) {
+        return NULL;
+    }
+
+    return GET_SMALL_VECTOR_ELEMENT(vec, vec->size - 1);
+}
+
+bool small_vector_get_element(struct small_vector *vec, const size_t index, void *element)
+{
+    if (!vec) {
+        fprintf(stderr, "vector is null at small_vector_get_element()\n");
+        return false;
+    }
+
+    if (!element) {
+        fprintf(stderr, "element is null at small_vector_get_element()\n");
+        return false;
+    }
+
+    if (index >= vec->size) {
+        fprintf(stderr, "index is greater than vector size at small_vector_get_element()\n");
+        return false;
+    }
+
+    memcpy(element, GET_SMALL_VECTOR_ELEMENT(vec, index), vec->e_size);
+
+    return true;
+}
+
+bool small_vector_search_element(struct small_vector *vec, const void *key, void *element, vector_cmp_func cmp)
+{
+    if (!vec) {
+        fprintf(stderr, "vector is null at small_vector_search_element()\n");
+        return false;
+    }
+
+    if (!key) {
+        fprintf(stderr, "key is null at small_vector_search_element()\n");
+        return false;
+    }
+
+    if (!cmp) {
+        fprintf(stderr, "comparision function is null at small_vector_search_element()\n");
+        return false;
+    }
+
+    for (size_t i = 0; i < vec->size; i++) {
+        void *vec_element = GET_SMALL_VECTOR_ELEMENT(vec, i);
+        if (cmp(vec_element, key)) {
+            if (element) {
+                memcpy(element, vec_element, vec->e_size);
+            }
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Views the elements as a `struct vector`, to reuse its scan kernels.
+ *
+ * The view does not own the elements and must not grow or be deinitialized.
+ */
+static struct vector small_vector_view(struct small_vector *vec)
+{
+    return (struct vector){SMALL_VECTOR_ITEMS(vec), vec->e_size, vec->size, vec->capacity, VECTOR_GROW_DOUBLE, 1};
+}
+
+bool small_vector_find_bytes(struct small_vector *vec, const void *key, size_t *index)
+{
+    if (!vec) {
+        fprintf(stderr, "vector is null at small_vector_find_bytes()\n");
+        return false;
+    }
+
+    if (!key) {
+        fprintf(stderr, "key is null at small_vector_find_bytes()\n");
+        return false;
+    }
+
+    const struct vector view = small_vector_view(vec);
+    return vector_find_bytes(&view, key, index);
+}
+
+size_t small_vector_count_bytes(struct small_vector *vec, const void *key)
+{
+    if (!vec) {
+        fprintf(stderr, "vector is null at small_vector_count_bytes()\n");
+        return 0;
+    }
+
+    if (!key) {
+        fprintf(stderr, "key is null at small_vector_count_bytes()\n");
+        return 0;
+    }
+
+    const struct vector view = small_vector_view(vec);
+    return vector_count_bytes(&view, key);
+}
+
+/**
+ * @brief Moves the elements to a heap block of exactly `capacity` elements.
+ *
+ * Spills an inline vector, or resizes the block of a spilled one.
+ */
+static bool small_vector_realloc(struct small_vector *vec, const size_t capacity)
+{
+    if (capacity > SIZE_MAX / vec->e_size) {
+        return false;
+    }
+
+    if (vec->heap) {
+        void *new_block = realloc(vec->heap, capacity * vec->e_size);
+        if (!new_block) {
+            return false;
+        }
+        vec->heap = new_block;
+    } else {
+        void *new_block = malloc(capacity * vec->e_size);
+        if (!new_block) {
+            return false;
+        }
+        memcpy(new_block, vec->inline_items.bytes, vec->size * vec->e_size);
+        vec->heap = new_block;
+    }
+    vec->capacity = capacity;
+
+    return true;
+}
+
+/**
+ * @brief Doubles the capacity until `needed` elements fit.
+ */
+static bool small_vector_grow(struct small_vector *vec, const size_t needed)
+{
+    if (needed <= vec->capacity) {
+        return true;
+    }
+
+    // Avoid multiplying zero
+    size_t capacity = vec->capacity ? vec->capacity * 2 : 1;
+    if (capacity < needed) {
+        capacity = needed;
+    }
+
+    return small_vector_realloc(vec, capacity);
+}
+
+bool small_vector_reserve(struct small_vector *vec, const size_t capacity)
+{
+    if (!vec) {
+        fprintf(stderr, "vector is null at small_vector_reserve()\n");
+        return false;
+    }
+
+    if (capacity <= vec->capacity) {
+        return true;
+    }
+
+    if (!small_vector_realloc(vec, capacity)) {
+        fprintf(stderr, "allocation failed at small_vector_reserve()\n");
+        return false;
+    }
+
+    return true;
+}
+
+bool small_vector_push_back(struct small_vector *vec, const void *element)
+{
+    if (!vec) {
+        fprintf(stderr, "vector is null at small_vector_push_back()\n");
+        return false;
+    }
+
+    if (!element) {
+        fprintf(stderr, "element is null at small_vector_push_back()\n");
+        return false;
+    }
+
+    if (!small_vector_grow(vec, vec->size + 1)) {
+        fprintf(stderr, "allocation failed at small_vector_push_back()\n");
+        return false;
+    }
+
+    memcpy(GET_SMALL_VECTOR_ELEMENT(vec, vec->size), element, vec->e_size);
+    vec->size++;
+
+    return true;
+}
+
+bool small_vector_push_back_n(struct small_vector *vec, const void *elements, const size_t count)
+{
+    if (!vec) {
+        fprintf(stderr, "vector is null at small_vector_push_back_n()\n");
+        return false;
+    }
+
+    if (!elements && count) {
+        fprintf(stderr, "elements is null at small_vector_push_back_n()\n");
+        return false;
+    }
+
+    if (count > SIZE_MAX - vec->size || !small_vector_grow(vec, vec->size + count)) {
+        fprintf(stderr, "allocation failed at small_vector_push_back_n()\n");
+        return false;
+    }
+
+    if (count) {
+        memcpy(GET_SMALL_VECTOR_ELEMENT(vec, vec->size), elements, count * vec->e_size);
+        vec->size += count;
+    }
+
+    return true;
+}
+
+bool small_vector_append_range(struct small_vector *vec, struct small_vector *src, const size_t first, const size_t count)
+{
+    if (!vec || !src) {
+        fprintf(stderr, "vector is null at small_vector_append_range()\n");
+        return false;
+    }
+
+    if (src->e_size != vec->e_size) {
+        fprintf(stderr, "element sizes differ at small_vector_append_range()\n");
+        return false;
+    }
+
+    if (first > src->size || count > src->size - first) {
+        fprintf(stderr, "range is out of bounds at small_vector_append_range()\n");
+        return false;
+    }
+
+    if (src == vec && (count > SIZE_MAX - vec->size || !small_vector_grow(vec, vec->size + count))) {
+        // Grow first, the source range moves along with the elements.
+        fprintf(stderr, "allocation failed at small_vector_append_range()\n");
+        return false;
+    }
+
+    return small_vector_push_back_n(vec, GET_SMALL_VECTOR_ELEMENT(src, first), count);
+}
+
+void *small_vector_emplace_back(struct small_vector *vec)
+{
+    if (!vec) {
+        fprintf(stderr, "vector is null at small_vector_emplace_back()\n");
+        return NULL;
+    }
+
+    if (!small_vector_grow(vec, vec->size + 1)) {
+        fprintf(stderr, "allocation failed at small_vector_emplace_back()\n");
+        return NULL;
+    }
+
+    return GET_SMALL_VECTOR_ELEMENT(vec, vec->size++);
+}
+
+bool small_vector_pop_index(struct small_vector *vec, const size_t index, void *element)
+{
+    if (!vec) {
+        fprintf(stderr, "vector is null at small_vector_pop_index()\n");
+        return false;
+    }
+
+    if (index >= vec->size) {
+        fprintf(stderr, "index is out of bounds at small_vector_pop_index()\n");
+        return false;
+    }
+
+    char *ele_ptr = GET_SMALL_VECTOR_ELEMENT(vec, index);
+    if (element) {
+        memcpy(element, ele_ptr, vec->e_size);
+    }
+
+    // Shift remaining elements left
+    if (index < vec->size - 1) {
+        memmove(ele_ptr, ele_ptr + vec->e_size, (vec->size - index - 1) * vec->e_size);
+    }
+    vec->size--;
+
+    return true;
+}
+
+bool small_vector_pop_search(struct small_vector *vec, const void *element)
+{
+    if (!vec) {
+        fprintf(stderr, "vector is null at small_vector_pop_search()\n");
+        return false;
+    }
+
+    if (!element) {
+        fprintf(stderr, "element is null at small_vector_pop_search()\n");
+        return false;
+    }
+
+    size_t index;
+    if (!small_vector_find_bytes(vec, element, &index)) {
+        return false;
+    }
+
+    return small_vector_erase_range(vec, index, 1);
+}
+
+size_t small_vector_remove_if(struct small_vector *vec, vector_pred_func pred, void *ctx)
+{
+    if (!vec) {
+        fprintf(stderr, "vector is null at small_vector_remove_if()\n");
+        return 0;
+    }
+
+    if (!pred) {
+        fprintf(stderr, "predicate is null at small_vector_remove_if()\n");
+        return 0;
+    }
+
+    size_t write = 0; // End of the kept elements
+    size_t run = 0;   // Start of the current run of kept elements, not moved yet
+
+    for (size_t read = 0; read <= vec->size; read++) {
+        if (read < vec->size && !pred(GET_SMALL_VECTOR_ELEMENT(vec, read), ctx)) {
+            continue;
+        }
+
+        if (read > run && run != write) {
+            memmove(GET_SMALL_VECTOR_ELEMENT(vec, write), GET_SMALL_VECTOR_ELEMENT(vec, run), (read - run) * vec->e_size);
+        }
+        write += read - run;
+        run = read + 1;
+    }
+
+    const size_t removed = vec->size - write;
+    vec->size = write;
+
+    return removed;
+}
+
+bool small_vector_swap_remove(struct small_vector *vec, const size_t index, void *element)
+{
+    if (!vec) {
+        fprintf(stderr, "vector is null at small_vector_swap_remove()\n");
+        return false;
+    }
+
+    if (index >= vec->size) {
+        fprintf(stderr, "index is out of bounds at small_vector_swap_remove()\n");
+        return false;
+    }
+
+    char *ele_ptr = GET_SMALL_VECTOR_ELEMENT(vec, index);
+    if (element) {
+        memcpy(element, ele_ptr, vec->e_size);
+    }
+
+    if (index < vec->size - 1) {
+        memcpy(ele_ptr, GET_SMALL_VECTOR_ELEMENT(vec, vec->size - 1), vec->e_size);
+    }
+    vec->size--;
+
+    return true;
+}
+
+bool small_vector_erase_range(struct small_vector *vec, const size_t first, const size_t count)
+{
+    if (!vec) {
+        fprintf(stderr, "vector is null at small_vector_erase_range()\n");
+        return false;
+    }
+
+    if (first > vec->size || count > vec->size - first) {
+        fprintf(stderr, "range is out of bounds at small_vector_erase_range()\n");
+        return false;
+    }
+
+    const size_t tail = vec->size - first - count;
+    if (count && tail) {
+        memmove(GET_SMALL_VECTOR_ELEMENT(vec, first), GET_SMALL_VECTOR_ELEMENT(vec, first + count), tail * vec->e_size);
+    }
+    vec->size -= count;
+
+    return true;
+}
+
+bool small_vector_shrink_to_fit(struct small_vector *vec)
+{
+    if (!vec) {
+        fprintf(stderr, "vector is null at small_vector_shrink_to_fit()\n");
+        return false;
+    }
+
+    if (!vec->heap) {
+        return true;
+    }
+
+    const size_t inline_capacity = SMALL_VECTOR_INLINE_BYTES / vec->e_size;
+    if (vec->size <= inline_capacity) {
+        // Fits inline again, give the block back.
+        void *heap = vec->heap;
+        memcpy(vec->inline_items.bytes, heap, vec->size * vec->e_size);
+        free(heap);
+        vec->heap = NULL;
+        vec->capacity = inline_capacity;
+        return true;
+    }
+
+    if (vec->size < vec->capacity && !small_vector_realloc(vec, vec->size)) {
+        fprintf(stderr, "realloc failed at small_vector_shrink_to_fit()\n");
+        return false;
+    }
+
+    return true;
+}
+
+void small_vector_deinitialize(struct small_vector *vec)
+{
+    if (!vec) {
+        return;
+    }
+
+    free(vec->heap);
+    vec->heap = NULL;
+    vec->size = 0;
+    vec->capacity = vec->e_size ? SMALL_VECTOR_INLINE_BYTES / vec->e_size : 0;
+}
@@ -0,0 +1,246 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "../vector/vector.h"
+
+/// Bytes of inline storage. Fixed, since it sets `sizeof(struct small_vector)`.
+#define SMALL_VECTOR_INLINE_BYTES 64
+
+/**
+ * @brief A vector keeping its first elements inside the struct.
+ *
+ * Up to `SMALL_VECTOR_INLINE_BYTES / e_size` elements are stored inline, so small
+ * vectors never allocate. Past that the elements move to the heap and it behaves
+ * like `struct vector`. The struct holds no pointer into itself, so it may be
+ * copied or moved with `memcpy()` as long as only one copy is used afterwards.
+ *
+ * Searching, removal and range functions mirror `vector`'s and take the same
+ * `vector_cmp_func` and `vector_pred_func` callbacks. Growth policies are not
+ * supported, a spilled vector always doubles.
+ */
+struct small_vector {
+    void *heap;            ///< Heap block once spilled, `NULL` while the elements are inline.
+    size_t e_size;         ///< Size of each element in bytes.
+    size_t size;           ///< Current number of elements in the vector.
+    size_t capacity;       ///< Capacity in elements, inline or on the heap.
+    union {
+        max_align_t align; ///< Aligns the inline storage for any element type.
+        unsigned char bytes[SMALL_VECTOR_INLINE_BYTES]; ///< Inline storage.
+    } inline_items;
+};
+
+/**
+ * @brief Initializes an empty small vector, without allocating.
+ *
+ * @param[in]  e_size  Size in bytes of each element.
+ * @param[out] vec     Pointer to the small vector structure to initialize.
+ *
+ * @return `true` on success, `false` on invalid arguments.
+ */
+bool small_vector_initialize(const size_t e_size, struct small_vector *vec);
+
+/**
+ * @brief Returns a pointer to the first element, the elements are contiguous.
+ *
+ * The pointer is valid until the vector grows, shrinks or is moved.
+ *
+ * @param[in] vec  Pointer to the initialized small vector.
+ *
+ * @return Pointer to the elements, `NULL` if `vec` is null.
+ */
+void *small_vector_data(struct small_vector *vec);
+
+/**
+ * @brief Returns a pointer to the element at a specific index, without copying it.
+ *
+ * @param[in] vec    Pointer to the initialized small vector.
+ * @param[in] index  Index of the element.
+ *
+ * @return Pointer to the element, `NULL` on invalid index or parameters.
+ */
+void *small_vector_at(struct small_vector *vec, const size_t index);
+
+/**
+ * @brief Returns a pointer to the last element, without copying it.
+ *
+ * @param[in] vec  Pointer to the initialized small vector.
+ *
+ * @return Pointer to the last element, `NULL` if the vector is empty.
+ */
+void *small_vector_back(struct small_vector *vec);
+
+/**
+ * @brief Searches for an element in the vector using a comparison function.
+ *
+ * If found, and if `element` is non-NULL, the matching element is copied into it.
+ *
+ * @param[in]  vec      Pointer to the initialized small vector.
+ * @param[in]  key      Pointer to the key to search for.
+ * @param[out] element  Optional pointer to store the found element.
+ * @param[in]  cmp      Comparison function: returns true on match.
+ *
+ * @return `true` if the element is found, `false` otherwise.
+ */
+bool small_vector_search_element(struct small_vector *vec, const void *key, void *element, vector_cmp_func cmp);
+
+/**
+ * @brief Finds the first element whose bytes equal the key's, with `vector_find_bytes()`'s SIMD scan.
+ *
+ * @param[in]  vec    Pointer to the initialized small vector.
+ * @param[in]  key    Pointer to `e_size` bytes to look for.
+ * @param[out] index  Optional pointer to store the index of the match.
+ *
+ * @return `true` if the element is found, `false` otherwise.
+ */
+bool small_vector_find_bytes(struct small_vector *vec, const void *key, size_t *index);
+
+/**
+ * @brief Counts the elements whose bytes equal the key's, like `small_vector_find_bytes()`.
+ *
+ * @param[in] vec  Pointer to the initialized small vector.
+ * @param[in] key  Pointer to `e_size` bytes to look for.
+ *
+ * @return Number of matching elements.
+ */
+size_t small_vector_count_bytes(struct small_vector *vec, const void *key);
+
+/**
+ * @brief Retrieves an element at a specific index.
+ *
+ * @param[in]  vec      Pointer to the initialized small vector.
+ * @param[in]  index    Index of the element to retrieve.
+ * @param[out] element  Buffer to store the retrieved element (`e_size` bytes).
+ *
+ * @return `true` on success, `false` on invalid index or parameters.
+ */
+bool small_vector_get_element(struct small_vector *vec, const size_t index, void *element);
+
+/**
+ * @brief Ensures the vector can hold at least `capacity` elements without reallocating.
+ *
+ * @param[in,out] vec       Pointer to the initialized small vector.
+ * @param[in]     capacity  Number of elements to make room for.
+ *
+ * @return `true` on success, `false` on allocation failure or invalid input.
+ */
+bool small_vector_reserve(struct small_vector *vec, const size_t capacity);
+
+/**
+ * @brief Appends an element to the end of the vector.
+ *
+ * Spills to the heap, or doubles the heap block, when the element does not fit.
+ *
+ * @param[in,out] vec      Pointer to the initialized small vector.
+ * @param[in]     element  Pointer to the element to append.
+ *
+ * @return `true` on success, `false` on allocation failure or invalid input.
+ */
+bool small_vector_push_back(struct small_vector *vec, const void *element);
+
+/**
+ * @brief Appends `count` contiguous elements with a single copy.
+ *
+ * @param[in,out] vec       Pointer to the initialized small vector.
+ * @param[in]     elements  Pointer to `count` elements of `e_size` bytes.
+ * @param[in]     count     Number of elements to append.
+ *
+ * @return `true` on success, `false` on allocation failure or invalid input.
+ */
+bool small_vector_push_back_n(struct small_vector *vec, const void *elements, const size_t count);
+
+/**
+ * @brief Appends `count` elements of another small vector, starting at `first`.
+ *
+ * `src` may be `vec` itself.
+ *
+ * @param[in,out] vec    Pointer to the initialized small vector.
+ * @param[in]     src    Small vector to copy from, with the same element size.
+ * @param[in]     first  Index of the first element to copy.
+ * @param[in]     count  Number of elements to copy.
+ *
+ * @return `true` on success, `false` on allocation failure or invalid input.
+ */
+bool small_vector_append_range(struct small_vector *vec, struct small_vector *src, const size_t first, const size_t count);
+
+/**
+ * @brief Appends an uninitialized element and returns it to be constructed in place.
+ *
+ * @param[in,out] vec  Pointer to the initialized small vector.
+ *
+ * @return Pointer to the new element, `NULL` on allocation failure or invalid input.
+ */
+void *small_vector_emplace_back(struct small_vector *vec);
+
+/**
+ * @brief Removes and returns the element at the given index.
+ *
+ * Subsequent elements are shifted left, the storage is never shrunk.
+ *
+ * @param[in,out] vec      Pointer to the initialized small vector.
+ * @param[in]     index    Index of the element to remove.
+ * @param[out]    element  Optional buffer to store the removed element.
+ *
+ * @return `true` on success, `false` on invalid index or input.
+ */
+bool small_vector_pop_index(struct small_vector *vec, const size_t index, void *element);
+
+/**
+ * @brief Removes the first element whose bytes equal `element`'s, keeping the order.
+ *
+ * @param[in,out] vec      Pointer to the initialized small vector.
+ * @param[in]     element  Pointer to the element to remove.
+ *
+ * @return `true` if an element was found and removed, `false` otherwise.
+ */
+bool small_vector_pop_search(struct small_vector *vec, const void *element);
+
+/**
+ * @brief Removes every element matching a predicate in a single pass, keeping the order.
+ *
+ * @param[in,out] vec   Pointer to the initialized small vector.
+ * @param[in]     pred  Predicate: returns true for elements to remove.
+ * @param[in]     ctx   Context passed to `pred`.
+ *
+ * @return Number of removed elements.
+ */
+size_t small_vector_remove_if(struct small_vector *vec, vector_pred_func pred, void *ctx);
+
+/**
+ * @brief Removes the element at the given index by moving the last element into its place.
+ *
+ * @param[in,out] vec      Pointer to the initialized small vector.
+ * @param[in]     index    Index of the element to remove.
+ * @param[out]    element  Optional buffer to store the removed element.
+ *
+ * @return `true` on success, `false` on invalid index or input.
+ */
+bool small_vector_swap_remove(struct small_vector *vec, const size_t index, void *element);
+
+/**
+ * @brief Removes `count` contiguous elements starting at `first` with a single move.
+ *
+ * @param[in,out] vec    Pointer to the initialized small vector.
+ * @param[in]     first  Index of the first element to remove.
+ * @param[in]     count  Number of elements to remove.
+ *
+ * @return `true` on success, `false` on invalid range or input.
+ */
+bool small_vector_erase_range(struct small_vector *vec, const size_t first, const size_t count);
+
+/**
+ * @brief Releases unused heap capacity, moving the elements back inline if they fit.
+ *
+ * @param[in,out] vec  Pointer to the initialized small vector.
+ *
+ * @return `true` on success, `false` on allocation failure or invalid input.
+ */
+bool small_vector_shrink_to_fit(struct small_vector *vec);
+
+/**
+ * @brief Frees the heap block if the vector spilled and resets it to an empty inline vector.
+ *
+ * @param[in,out] vec  Pointer to the small vector to clean up.
+ */
+void small_vector_deinitialize(struct small_vector *vec);
@@ -0,0 +1,317 @@
+#include "swiss_map.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SM_USE_SSE2 1
+#endif
+
+/** Control byte of a never used slot. */
+#define SM_EMPTY ((int8_t)-128)
+/** Control byte of a deleted slot (tombstone). */
+#define SM_DELETED ((int8_t)-2)
+
+#define SM_SLOT(map, slots, index) ((char *)(slots) + ((index) * (map)->slot_size))
+#define SM_VALUE(map, slot) ((void *)((char *)(slot) + (map)->value_offset))
+#define SM_H1(hash) ((size_t)((hash) >> 7))
+#define SM_H2(hash) ((int8_t)((hash) & 0x7f))
+#define SM_MAX_LOAD(capacity) ((capacity) - (capacity) / 8)
+
+/**
+ * @brief Index of the lowest set bit, mask must not be 0.
+ */
+static inline unsigned sm_ctz(uint32_t mask)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_ctz(mask);
+#else
+    unsigned n = 0;
+    while (!(mask & 1)) {
+        mask >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+/**
+ * @brief Compares a group of control bytes against a byte.
+ *
+ * @param[in] group Pointer to SM_GROUP_WIDTH control bytes.
+ * @param[in] byte  Byte to look for.
+ *
+ * @return Bitmask with bit i set if group[i] == byte.
+ */
+static inline uint32_t sm_match(const int8_t *group, const int8_t byte)
+{
+#ifdef SM_USE_SSE2
+    const __m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(byte)));
+#else
+    uint32_t mask = 0;
+    for (unsigned i = 0; i < SM_GROUP_WIDTH; i++) {
+        mask |= (uint32_t)(group[i] == byte) << i;
+    }
+    return mask;
+#endif
+}
+
+/**
+ * @brief Finds the EMPTY or DELETED slots in a group, both have the sign bit set.
+ *
+ * @param[in] group Pointer to SM_GROUP_WIDTH control bytes.
+ *
+ * @return Bitmask with bit i set if group[i] is not full.
+ */
+static inline uint32_t sm_match_free(const int8_t *group)
+{
+#ifdef SM_USE_SSE2
+    return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)group));
+#else
+    uint32_t mask = 0;
+    for (unsigned i = 0; i < SM_GROUP_WIDTH; i++) {
+        mask |= (uint32_t)(group[i] < 0) << i;
+    }
+    return mask;
+#endif
+}
+
+/**
+ * @brief Sets a control byte, keeping the mirrored tail in sync.
+ */
+static inline void sm_set_ctrl(struct swiss_map *map, const size_t index, const int8_t byte)
+{
+    map->ctrl[index] = byte;
+    if (index < SM_GROUP_WIDTH) {
+        map->ctrl[map->capacity + index] = byte;
+    }
+}
+
+/**
+ * @brief Allocates empty control bytes and slots for a capacity.
+ *
+ * @return true if successful, false otherwise.
+ */
+static bool sm_alloc(struct swiss_map *map, const size_t capacity)
+{
+    int8_t *ctrl = malloc(capacity + SM_GROUP_WIDTH);
+    if (!ctrl) {
+        return false;
+    }
+
+    void *slots = malloc(capacity * map->slot_size);
+    if (!slots) {
+        free(ctrl);
+        return false;
+    }
+
+    memset(ctrl, (unsigned char)SM_EMPTY, capacity + SM_GROUP_WIDTH);
+    map->ctrl = ctrl;
+    map->slots = slots;
+    map->capacity = capacity;
+    map->growth_left = SM_MAX_LOAD(capacity) - map->size;
+    return true;
+}
+
+void sm_init(const size_t key_size, const size_t value_size, const size_t capacity, const hash_func hash, const cmp_func cmp, struct swiss_map *map)
+{
+    if (!map) {
+        return;
+    }
+
+    // Every field is valid for sm_destroy even if initialization fails below.
+    memset(map, 0, sizeof(*map));
+
+    if (key_size == 0 || value_size == 0 || capacity == 0 || !cmp) {
+        return;
+    }
+
+    size_t rounded = SM_GROUP_WIDTH;
+    while (rounded < capacity) {
+        rounded <<= 1;
+    }
+
+    map->key_size = key_size;
+    map->value_size = value_size;
+    map->value_offset = (key_size + 7) & ~(size_t)7;
+    map->slot_size = map->value_offset + ((value_size + 7) & ~(size_t)7);
+    map->size = 0;
+    map->hash = hash ? hash : hm_hash_bytes;
+    map->cmp = cmp;
+
+    // On failure `ctrl` stays NULL, which every other function checks.
+    sm_alloc(map, rounded);
+}
+
+/**
+ * @brief Finds the slot holding a key.
+ *
+ * Probes group by group with a triangular sequence, which visits every group
+ * of a power of two table. Only slots whose 7-bit fragment matches are compared.
+ *
+ * @param[in] map  Pointer to swiss_map struct.
+ * @param[in] key  Key to search.
+ * @param[in] hash Hash of the key.
+ *
+ * @return Pointer to the slot if found, NULL otherwise.
+ */
+static void *sm_find(const struct swiss_map *map, const void *key, const uint64_t hash)
+{
+    const size_t mask = map->capacity - 1;
+    const int8_t h2 = SM_H2(hash);
+    size_t pos = SM_H1(hash) & mask;
+
+    for (size_t stride = SM_GROUP_WIDTH; ; stride += SM_GROUP_WIDTH) {
+        const int8_t *group = map->ctrl + pos;
+
+        for (uint32_t match = sm_match(group, h2); match; match &= match - 1) {
+            void *slot = SM_SLOT(map, map->slots, (pos + sm_ctz(match)) & mask);
+            if (map->cmp(slot, key) == 0) {
+                return slot;
+            }
+        }
+
+        // An EMPTY slot ends the probe sequence, the key would have been placed there.
+        if (sm_match(group, SM_EMPTY)) {
+            return NULL;
+        }
+
+        if (stride > map->capacity) {
+            return NULL;
+        }
+        pos = (pos + stride) & mask;
+    }
+}
+
+/**
+ * @brief Finds the first EMPTY or DELETED slot in a key's probe sequence.
+ *
+ * There is always one since the load is kept below 7/8.
+ *
+ * @return Index of the slot.
+ */
+static size_t sm_find_free(const struct swiss_map *map, const uint64_t hash)
+{
+    const size_t mask = map->capacity - 1;
+    size_t pos = SM_H1(hash) & mask;
+
+    for (size_t stride = SM_GROUP_WIDTH; ; stride += SM_GROUP_WIDTH) {
+        const uint32_t free_slots = sm_match_free(map->ctrl + pos);
+        if (free_slots) {
+            return (pos + sm_ctz(free_slots)) & mask;
+        }
+        pos = (pos + stride) & mask;
+    }
+}
+
+/**
+ * @brief Moves every entry into a fresh table, dropping all tombstones.
+ *
+ * @param[in] map          Pointer to swiss_map struct.
+ * @param[in] new_capacity Capacity of the new table, a power of two.
+ */
+static void sm_rehash(struct swiss_map *map, const size_t new_capacity)
+{
+    int8_t *old_ctrl = map->ctrl;
+    void *old_slots = map->slots;
+    const size_t old_capacity = map->capacity;
+
+    if (!sm_alloc(map, new_capacity)) {
+        return;
+    }
+
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old_ctrl[i] < 0) {
+            continue;
+        }
+
+        void *old_slot = SM_SLOT(map, old_slots, i);
+        const uint64_t hash = map->hash(old_slot, map->key_size);
+        const size_t index = sm_find_free(map, hash);
+        memcpy(SM_SLOT(map, map->slots, index), old_slot, map->slot_size);
+        sm_set_ctrl(map, index, SM_H2(hash));
+    }
+
+    free(old_ctrl);
+    free(old_slots);
+}
+
+void *sm_get(const struct swiss_map *map, const void *key)
+{
+    if (!map || !map->ctrl || !key) {
+        return NULL;
+    }
+
+    void *slot = sm_find(map, key, map->hash(key, map->key_size));
+    return slot ? SM_VALUE(map, slot) : NULL;
+}
+
+void sm_insert(struct swiss_map *map, const void *key, const void *value)
+{
+    if (!map || !map->ctrl || !key || !value) {
+        return;
+    }
+
+    const uint64_t hash = map->hash(key, map->key_size);
+
+    void *slot = sm_find(map, key, hash);
+    if (slot) {
+        memcpy(SM_VALUE(map, slot), value, map->value_size);
+        return;
+    }
+
+    size_t index = sm_find_free(map, hash);
+    if (map->growth_left == 0 && map->ctrl[index] == SM_EMPTY) {
+        // Mostly tombstones: clean up in place, otherwise grow.
+        const size_t new_capacity = map->size < map->capacity / 2 ? map->capacity : map->capacity * 2;
+        sm_rehash(map, new_capacity);
+        if (map->growth_left == 0) {
+            return;
+        }
+        index = sm_find_free(map, hash);
+    }
+
+    slot = SM_SLOT(map, map->slots, index);
+    memcpy(slot, key, map->key_size);
+    memcpy(SM_VALUE(map, slot), value, map->value_size);
+
+    if (map->ctrl[index] == SM_EMPTY) {
+        map->growth_left--;
+    }
+    sm_set_ctrl(map, index, SM_H2(hash));
+    map->size++;
+}
+
+void sm_delete(struct swiss_map *map, const void *key)
+{
+    if (!map || !map->ctrl || !key) {
+        return;
+    }
+
+    char *slot = sm_find(map, key, map->hash(key, map->key_size));
+    if (!slot) {
+        return;
+    }
+
+    const size_t index = (size_t)(slot - (char *)map->slots) / map->slot_size;
+    sm_set_ctrl(map, index, SM_DELETED);
+    map->size--;
+}
+
+void sm_destroy(struct swiss_map *map)
+{
+    if (!map) {
+        return;
+    }
+
+    free(map->ctrl);
+    map->ctrl = NULL;
+    free(map->slots);
+    map->slots = NULL;
+    map->capacity = 0;
+    map->growth_left = 0;
+    map->cmp = NULL;
+    map->size = 0;
+}
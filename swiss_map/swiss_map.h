@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "../hash_map/hash_map.h"
+
+/** Number of control bytes probed at once. */
+#define SM_GROUP_WIDTH 16
+
+/**
+ * @struct swiss_map
+ * @brief  Hash map with a separate control byte per slot (Swiss table layout).
+ *
+ * Each control byte holds either EMPTY, DELETED or the low 7 bits of the key's hash.
+ * Lookups compare 16 control bytes at a time (SSE2 when available) and only read
+ * the slots whose fragment matches, so most probes never touch keys or call `cmp`.
+ */
+struct swiss_map {
+    /** Key's size. */
+    size_t key_size;
+    /** Value's size. */
+    size_t value_size;
+    /** Control bytes, `capacity + SM_GROUP_WIDTH` long, the tail mirrors the first group. */
+    int8_t *ctrl;
+    /** Slab of inline slots, each holding the key followed by the value. */
+    void *slots;
+    /** Size of a single slot. */
+    size_t slot_size;
+    /** Offset of the value inside a slot. */
+    size_t value_offset;
+    /** Current size of the swiss map. */
+    size_t size;
+    /** Capacity of the swiss map, always a power of two. */
+    size_t capacity;
+    /** Number of EMPTY slots that can still be filled before resizing. */
+    size_t growth_left;
+    /** Hash function for the keys. */
+    hash_func hash;
+    /** Custom comparasion function for comparing keys. */
+    cmp_func cmp;
+};
+
+/**
+ * @brief Initializes the swiss map.
+ *        Every field is zeroed first, so sm_destroy is safe even if `ctrl` stays NULL.
+ *
+ * @param[in]  key_size   Key's size.
+ * @param[in]  value_size Value's size.
+ * @param[in]  capacity   Initial capacity, rounded up to a power of two of at least 16.
+ * @param[in]  hash       Hash function for the keys, NULL for hm_hash_bytes.
+ * @param[in]  cmp        Custom comparision function used for comparing keys.
+ * @param[out] map        Pointer to caller allocated swiss_map struct.
+ */
+void sm_init(const size_t key_size, const size_t value_size, const size_t capacity, const hash_func hash, const cmp_func cmp, struct swiss_map *map);
+/**
+ * @brief Gets value from its key.
+ *
+ * @param[in] map Pointer to swiss_map struct.
+ * @param[in] key Key to search.
+ *
+ * @return Key's value if found, NULL otherwise. Valid until the next insert or delete.
+ */
+void *sm_get(const struct swiss_map *map, const void *key);
+/**
+ * @brief Inserts a key into the swiss map, overwriting the value if it already exists.
+ *
+ * @param[in] map   Pointer to swiss_map struct.
+ * @param[in] key   Key to insert.
+ * @param[in] value Value to insert.
+ */
+void sm_insert(struct swiss_map *map, const void *key, const void *value);
+/**
+ * @brief Deletes an entry in the swiss map.
+ *
+ * @param[in] map Pointer to swiss_map struct.
+ * @param[in] key Key to delete.
+ */
+void sm_delete(struct swiss_map *map, const void *key);
+/**
+ * @brief Destroys the swiss map.
+ *
+ * @param[in] map Pointer to swiss_map struct.
+ */
+void sm_destroy(struct swiss_map *map);
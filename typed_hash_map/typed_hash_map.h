@@ -0,0 +1,206 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * @brief Hashes an integer key, for use as HASH_MAP_DECLARE's `hash`.
+ *
+ * Multiply-xorshift finalizer, spreads consecutive integers over the low bits
+ * the table is indexed with.
+ *
+ * @param[in] key Key to hash.
+ *
+ * @return 64-bit hash of the key.
+ */
+static inline uint64_t thm_hash_u64(uint64_t key)
+{
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdull;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ull;
+    key ^= key >> 33;
+    return key;
+}
+
+/**
+ * @brief Equality of scalar keys, for use as HASH_MAP_DECLARE's `eq`.
+ */
+#define THM_EQ_SCALAR(a, b) ((a) == (b))
+
+/**
+ * @brief Declares a hash map specialized for key type K and value type V.
+ *
+ * Emits `struct name` and static inline `name_init`, `name_get`, `name_insert`,
+ * `name_delete` and `name_destroy` with the same semantics as the hm_* functions,
+ * but with keys and values stored inline as K and V, and `hash` and `eq` called
+ * directly so the compiler can inline them. Open addressing with linear probing
+ * over a power of two table of at least 8 slots, resized at 0.7 load, deletes
+ * shift entries back instead of leaving tombstones. The occupied flag lives in
+ * each entry, so a probe touches only the entry's cache line. `name_insert`
+ * returns false if the table was full and could not grow, or was never
+ * initialized, instead of dropping the key; on such a map `name_get` returns
+ * NULL and `name_delete` does nothing, like hm_get and hm_delete.
+ *
+ * @param name Prefix of the generated struct and functions.
+ * @param K    Key type, passed and compared by value.
+ * @param V    Value type.
+ * @param hash Function or macro, `uint64_t hash(K key)`.
+ * @param eq   Function or macro, `bool eq(K a, K b)`.
+ */
+#define HASH_MAP_DECLARE(name, K, V, hash, eq)                                              \
+                                                                                            \
+struct name##_entry {                                                                       \
+    /** Key of the entry. */                                                                \
+    K key;                                                                                  \
+    /** Value of the entry. */                                                              \
+    V value;                                                                                \
+    /** Whether the entry is occupied, inline so a probe reads one entry. */                \
+    bool used;                                                                              \
+};                                                                                          \
+                                                                                            \
+struct name {                                                                               \
+    /** Table of entries. */                                                                \
+    struct name##_entry *entries;                                                           \
+    /** Current size of the map. */                                                         \
+    size_t size;                                                                            \
+    /** Capacity of the map, always a power of two, 0 if not initialized. */                \
+    size_t capacity;                                                                        \
+};                                                                                          \
+                                                                                            \
+static inline bool name##_alloc(struct name *map, const size_t capacity)                    \
+{                                                                                           \
+    /* calloc leaves every entry unused. */                                                 \
+    struct name##_entry *entries = calloc(capacity, sizeof(struct name##_entry));           \
+    if (!entries) {                                                                         \
+        return false;                                                                       \
+    }                                                                                       \
+    map->entries = entries;                                                                 \
+    map->capacity = capacity;                                                               \
+    return true;                                                                            \
+}                                                                                           \
+                                                                                            \
+static inline bool name##_init(const size_t capacity, struct name *map)                     \
+{                                                                                           \
+    if (!map) {                                                                             \
+        return false;                                                                       \
+    }                                                                                       \
+    map->entries = NULL;                                                                    \
+    map->size = 0;                                                                          \
+    map->capacity = 0;                                                                      \
+    if (capacity == 0) {                                                                    \
+        return false;                                                                       \
+    }                                                                                       \
+    size_t rounded = 8;                                                                     \
+    while (rounded < capacity) {                                                            \
+        rounded <<= 1;                                                                      \
+    }                                                                                       \
+    return name##_alloc(map, rounded);                                                      \
+}                                                                                           \
+                                                                                            \
+static inline V *name##_get(const struct name *map, const K key)                            \
+{                                                                                           \
+    if (map->capacity == 0) {                                                               \
+        return NULL;                                                                        \
+    }                                                                                       \
+    const size_t mask = map->capacity - 1;                                                  \
+    for (size_t i = (size_t)hash(key) & mask; map->entries[i].used; i = (i + 1) & mask) {   \
+        if (eq(map->entries[i].key, key)) {                                                 \
+            return &map->entries[i].value;                                                  \
+        }                                                                                   \
+    }                                                                                       \
+    return NULL;                                                                            \
+}                                                                                           \
+                                                                                            \
+static inline bool name##_resize(struct name *map)                                          \
+{                                                                                           \
+    struct name##_entry *old_entries = map->entries;                                        \
+    const size_t old_capacity = map->capacity;                                              \
+    if (!name##_alloc(map, old_capacity * 2)) {                                             \
+        return false;                                                                       \
+    }                                                                                       \
+    const size_t mask = map->capacity - 1;                                                  \
+    for (size_t j = 0; j < old_capacity; j++) {                                             \
+        if (!old_entries[j].used) {                                                         \
+            continue;                                                                       \
+        }                                                                                   \
+        size_t i = (size_t)hash(old_entries[j].key) & mask;                                 \
+        while (map->entries[i].used) {                                                      \
+            i = (i + 1) & mask;                                                             \
+        }                                                                                   \
+        map->entries[i] = old_entries[j];                                                   \
+    }                                                                                       \
+    free(old_entries);                                                                      \
+    return true;                                                                            \
+}                                                                                           \
+                                                                                            \
+static inline bool name##_insert(struct name *map, const K key, const V value)              \
+{                                                                                           \
+    if (map->capacity == 0) {                                                               \
+        return false;                                                                       \
+    }                                                                                       \
+    size_t mask = map->capacity - 1;                                                        \
+    size_t i = (size_t)hash(key) & mask;                                                    \
+    for (; map->entries[i].used; i = (i + 1) & mask) {                                      \
+        if (eq(map->entries[i].key, key)) {                                                 \
+            map->entries[i].value = value;                                                  \
+            return true;                                                                    \
+        }                                                                                   \
+    }                                                                                       \
+    /* Keep the load at most 0.7, and always one free slot to end probes. */                \
+    if ((map->size + 1) * 10 > map->capacity * 7) {                                         \
+        if (!name##_resize(map) && map->size + 1 >= map->capacity) {                        \
+            return false;                                                                   \
+        }                                                                                   \
+        mask = map->capacity - 1;                                                           \
+        i = (size_t)hash(key) & mask;                                                       \
+        while (map->entries[i].used) {                                                      \
+            i = (i + 1) & mask;                                                             \
+        }                                                                                   \
+    }                                                                                       \
+    map->entries[i].key = key;                                                              \
+    map->entries[i].value = value;                                                          \
+    map->entries[i].used = true;                                                            \
+    map->size++;                                                                            \
+    return true;                                                                            \
+}                                                                                           \
+                                                                                            \
+static inline void name##_delete(struct name *map, const K key)                             \
+{                                                                                           \
+    if (map->capacity == 0) {                                                               \
+        return;                                                                             \
+    }                                                                                       \
+    const size_t mask = map->capacity - 1;                                                  \
+    size_t i = (size_t)hash(key) & mask;                                                    \
+    for (; map->entries[i].used; i = (i + 1) & mask) {                                      \
+        if (eq(map->entries[i].key, key)) {                                                 \
+            break;                                                                          \
+        }                                                                                   \
+    }                                                                                       \
+    if (!map->entries[i].used) {                                                            \
+        return;                                                                             \
+    }                                                                                       \
+    /* Backward shift: pull later entries of the chain into the hole. */                    \
+    for (size_t j = (i + 1) & mask; map->entries[j].used; j = (j + 1) & mask) {             \
+        const size_t home = (size_t)hash(map->entries[j].key) & mask;                       \
+        const bool stays = i <= j ? (i < home && home <= j) : (i < home || home <= j);      \
+        if (!stays) {                                                                       \
+            map->entries[i] = map->entries[j];                                              \
+            i = j;                                                                          \
+        }                                                                                   \
+    }                                                                                       \
+    map->entries[i].used = false;                                                           \
+    map->size--;                                                                            \
+}                                                                                           \
+                                                                                            \
+static inline void name##_destroy(struct name *map)                                         \
+{                                                                                           \
+    if (!map) {                                                                             \
+        return;                                                                             \
+    }                                                                                       \
+    free(map->entries);                                                                     \
+    map->entries = NULL;                                                                    \
+    map->size = 0;                                                                          \
+    map->capacity = 0;                                                                      \
+}
@@ -1,10 +1,24 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <string.h>
 #include "vector.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VECTOR_USE_SSE2 1
+#endif
+
+// AVX2 kernels are compiled with a target attribute and only run if the CPU has it.
+#if defined(VECTOR_USE_SSE2) && (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define VECTOR_HAVE_AVX2 1
+#endif
+
 #define GET_ELEMENT(array, index, element_size) ((char *)(array) + ((index) * (element_size)))
 #define GET_VECTOR_ELEMENT(vector, index) (GET_ELEMENT((vector)->items, (index), (vec->e_size)))
+/// Returned by the scan kernels when nothing matches.
+#define VECTOR_NOT_FOUND ((size_t)-1)
 
 bool vector_initialize(const size_t capacity, const size_t e_size, struct vector *vec)
 {
@@ -25,12 +39,78 @@ bool vector_initialize(const size_t capacity, const size_t e_size, struct vector
     }
     vec->e_size = e_size;
     memset(vec->items, 0, e_size);
+    vec->size = 0;
+    vec->capacity = capacity;
+    vec->growth = VECTOR_GROW_DOUBLE;
+    vec->growth_chunk = 1;
+
+    return true;
+}
+
+/**
+ * @brief Reallocates the vector to exactly `capacity` elements.
+ */
+static bool vector_realloc(struct vector *vec, const size_t capacity)
+{
+    void *new_block = realloc(vec->items, capacity * vec->e_size);
+    if (!new_block) {
+        return false;
+    }
+    vec->items = new_block;
     vec->capacity = capacity;
 
     return true;
 }
 
-bool vector_search_element(const struct vector *vec, const void *key, void *element, cmp_func cmp)
+/**
+ * @brief Grows the vector by its growth policy until `needed` elements fit.
+ *
+ * Every policy is capped at the largest capacity whose size in bytes fits a size_t.
+ */
+static bool vector_grow(struct vector *vec, const size_t needed)
+{
+    if (needed <= vec->capacity) {
+        return true;
+    }
+
+    const size_t max_capacity = SIZE_MAX / vec->e_size;
+    if (needed > max_capacity) {
+        return false;
+    }
+
+    // Avoid multiplying zero
+    size_t capacity = vec->capacity ? vec->capacity : 1;
+    size_t growth;
+
+    switch (vec->growth) {
+    case VECTOR_GROW_HALF:
+        growth = capacity / 2 ? capacity / 2 : 1;
+        break;
+    case VECTOR_GROW_CHUNK:
+        capacity = vec->capacity;
+        growth = vec->growth_chunk ? vec->growth_chunk : 1;
+        break;
+    case VECTOR_GROW_PAGE:
+    case VECTOR_GROW_DOUBLE:
+    default:
+        growth = capacity;
+        break;
+    }
+
+    capacity = growth > max_capacity - capacity ? max_capacity : capacity + growth;
+
+    if (vec->growth == VECTOR_GROW_PAGE) {
+        const size_t bytes = capacity * vec->e_size;
+        // Round up to whole pages unless that would wrap.
+        if (bytes <= SIZE_MAX - (VECTOR_PAGE_SIZE - 1)) {
+            capacity = ((bytes + VECTOR_PAGE_SIZE - 1) & ~(size_t)(VECTOR_PAGE_SIZE - 1)) / vec->e_size;
+        }
+    }
+
+    return vector_realloc(vec, capacity > needed ? capacity : needed);
+}
+
+bool vector_search_element(const struct vector *vec, const void *key, void *element, vector_cmp_func cmp)
 {
     if (!vec) {
         fprintf(stderr, "vector is null at vector_search_element()\n");
@@ -65,6 +145,275 @@ bool vector_search_element(const struct vector *vec, const void *key, void *elem
     return false;
 }
 
+/*
+scanning for a key
+
+the key is broadcast to every lane, lanes are compared with it and the compare
+result is turned into a bitmask with one bit per byte, so a matching element
+of `width` bytes sets `width` consecutive bits
+
+find:  index of the first match = (offset + ctz(mask)) / width
+count: matches                  = popcount(mask) / width
+*/
+
+/**
+ * @brief Scans elements one by one, also used for the tail of the SIMD kernels.
+ */
+static size_t vector_scan_scalar(const char *items, const size_t count, const size_t width, const void *key, const bool find)
+{
+    size_t found = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        if (memcmp(items + i * width, key, width) == 0) {
+            if (find) {
+                return i;
+            }
+            found++;
+        }
+    }
+
+    return find ? VECTOR_NOT_FOUND : found;
+}
+
+#ifdef VECTOR_USE_SSE2
+static inline unsigned vector_ctz(uint32_t mask)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_ctz(mask);
+#else
+    unsigned n = 0;
+    while (!(mask & 1)) {
+        mask >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+static inline unsigned vector_popcount(uint32_t mask)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_popcount(mask);
+#else
+    unsigned n = 0;
+    for (; mask; mask &= mask - 1) {
+        n++;
+    }
+    return n;
+#endif
+}
+
+/**
+ * @brief Compares 16 bytes of elements with the broadcast key.
+ *
+ * @return Bitmask with the bytes of every matching element set.
+ */
+static inline uint32_t vector_match_sse2(const __m128i block, const __m128i needle, const size_t width)
+{
+    __m128i eq;
+
+    switch (width) {
+    case 1:
+        eq = _mm_cmpeq_epi8(block, needle);
+        break;
+    case 2:
+        eq = _mm_cmpeq_epi16(block, needle);
+        break;
+    case 4:
+        eq = _mm_cmpeq_epi32(block, needle);
+        break;
+    default:
+        // No 64-bit compare in SSE2: both 32-bit halves have to match.
+        eq = _mm_cmpeq_epi32(block, needle);
+        eq = _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+        break;
+    }
+
+    return (uint32_t)_mm_movemask_epi8(eq);
+}
+
+static inline size_t vector_scan_sse2(const char *items, const size_t count, const size_t width, const void *key, const bool find)
+{
+    uint64_t k = 0;
+    memcpy(&k, key, width);
+
+    __m128i needle;
+    switch (width) {
+    case 1: needle = _mm_set1_epi8((char)k); break;
+    case 2: needle = _mm_set1_epi16((short)k); break;
+    case 4: needle = _mm_set1_epi32((int)k); break;
+    default: needle = _mm_set1_epi64x((long long)k); break;
+    }
+
+    const size_t bytes = count * width;
+    size_t found = 0;
+    size_t offset = 0;
+
+    for (; offset + 16 <= bytes; offset += 16) {
+        const uint32_t mask = vector_match_sse2(_mm_loadu_si128((const __m128i *)(items + offset)), needle, width);
+        if (mask) {
+            if (find) {
+                return (offset + vector_ctz(mask)) / width;
+            }
+            found += vector_popcount(mask);
+        }
+    }
+
+    const size_t done = offset / width;
+    const size_t tail = vector_scan_scalar(items + offset, count - done, width, key, find);
+    if (find) {
+        return tail == VECTOR_NOT_FOUND ? tail : done + tail;
+    }
+    return found / width + tail;
+}
+#endif
+
+#ifdef VECTOR_HAVE_AVX2
+__attribute__((target("avx2")))
+static inline uint32_t vector_match_avx2(const __m256i block, const __m256i needle, const size_t width)
+{
+    __m256i eq;
+
+    switch (width) {
+    case 1: eq = _mm256_cmpeq_epi8(block, needle); break;
+    case 2: eq = _mm256_cmpeq_epi16(block, needle); break;
+    case 4: eq = _mm256_cmpeq_epi32(block, needle); break;
+    default: eq = _mm256_cmpeq_epi64(block, needle); break;
+    }
+
+    return (uint32_t)_mm256_movemask_epi8(eq);
+}
+
+__attribute__((target("avx2")))
+static inline size_t vector_scan_avx2(const char *items, const size_t count, const size_t width, const void *key, const bool find)
+{
+    uint64_t k = 0;
+    memcpy(&k, key, width);
+
+    __m256i needle;
+    switch (width) {
+    case 1: needle = _mm256_set1_epi8((char)k); break;
+    case 2: needle = _mm256_set1_epi16((short)k); break;
+    case 4: needle = _mm256_set1_epi32((int)k); break;
+    default: needle = _mm256_set1_epi64x((long long)k); break;
+    }
+
+    const size_t bytes = count * width;
+    size_t found = 0;
+    size_t offset = 0;
+
+    for (; offset + 32 <= bytes; offset += 32) {
+        const uint32_t mask = vector_match_avx2(_mm256_loadu_si256((const __m256i *)(items + offset)), needle, width);
+        if (mask) {
+            if (find) {
+                return (offset + vector_ctz(mask)) / width;
+            }
+            found += vector_popcount(mask);
+        }
+    }
+
+    // Less than 32 bytes left, finish them 16 at a time.
+    const size_t done = offset / width;
+    const size_t tail = vector_scan_sse2(items + offset, count - done, width, key, find);
+    if (find) {
+        return tail == VECTOR_NOT_FOUND ? tail : done + tail;
+    }
+    return found / width + tail;
+}
+
+/**
+ * @brief Dispatches to the AVX2 kernel of a constant width.
+ */
+__attribute__((target("avx2")))
+static size_t vector_scan_avx2_width(const char *items, const size_t count, const size_t width, const void *key, const bool find)
+{
+    switch (width) {
+    case 1: return vector_scan_avx2(items, count, 1, key, find);
+    case 2: return vector_scan_avx2(items, count, 2, key, find);
+    case 4: return vector_scan_avx2(items, count, 4, key, find);
+    default: return vector_scan_avx2(items, count, 8, key, find);
+    }
+}
+#endif
+
+/**
+ * @brief Scans the vector for the key with the best kernel for its element size and the CPU.
+ *
+ * @return Index of the first match if `find`, number of matches otherwise.
+ */
+static size_t vector_scan(const struct vector *vec, const void *key, const bool find)
+{
+    const size_t width = vec->e_size;
+
+    if (width != 1 && width != 2 && width != 4 && width != 8) {
+        return vector_scan_scalar(vec->items, vec->size, width, key, find);
+    }
+
+#ifdef VECTOR_HAVE_AVX2
+    if (__builtin_cpu_supports("avx2")) {
+        return vector_scan_avx2_width(vec->items, vec->size, width, key, find);
+    }
+#endif
+
+#ifdef VECTOR_USE_SSE2
+    // Constant widths, so each call gets its own kernel with the switches folded away.
+    switch (width) {
+    case 1: return vector_scan_sse2(vec->items, vec->size, 1, key, find);
+    case 2: return vector_scan_sse2(vec->items, vec->size, 2, key, find);
+    case 4: return vector_scan_sse2(vec->items, vec->size, 4, key, find);
+    default: return vector_scan_sse2(vec->items, vec->size, 8, key, find);
+    }
+#else
+    return vector_scan_scalar(vec->items, vec->size, width, key, find);
+#endif
+}
+
+bool vector_find_bytes(const struct vector *vec, const void *key, size_t *index)
+{
+    if (!vec) {
+        fprintf(stderr, "vector is null at vector_find_bytes()\n");
+        return false;
+    }
+
+    if (!key) {
+        fprintf(stderr, "key is null at vector_find_bytes()\n");
+        return false;
+    }
+
+    if (vec->size == 0) {
+        return false;
+    }
+
+    const size_t found = vector_scan(vec, key, true);
+    if (found == VECTOR_NOT_FOUND) {
+        return false;
+    }
+
+    if (index) {
+        *index = found;
+    }
+    return true;
+}
+
+size_t vector_count_bytes(const struct vector *vec, const void *key)
+{
+    if (!vec) {
+        fprintf(stderr, "vector is null at vector_count_bytes()\n");
+        return 0;
+    }
+
+    if (!key) {
+        fprintf(stderr, "key is null at vector_count_bytes()\n");
+        return 0;
+    }
+
+    if (vec->size == 0) {
+        return 0;
+    }
+
+    return vector_scan(vec, key, false);
+}
+
 bool vector_get_element(const struct vector *vec, const size_t index, void *element)
 {
     if (!vec) {
@@ -88,6 +437,60 @@ bool vector_get_element(const struct vector *vec, const size_t index, void *elem
     return true;
 }
 
+void *vector_at(const struct vector *vec, const size_t index)
+{
+    if (!vec) {
+        fprintf(stderr, "vector is null at vector_at()\n");
+        return NULL;
+    }
+
+    if (index >= vec->size) {
+        fprintf(stderr, "index is out of bounds at vector_at()\n");
+        return NULL;
+    }
+
+    return GET_VECTOR_ELEMENT(vec, index);
+}
+
+void *vector_data(const struct vector *vec)
+{
+    if (!vec) {
+        fprintf(stderr, "vector is null at vector_data()\n");
+        return NULL;
+    }
+
+    return vec->items;
+}
+
+void *vector_back(const struct vector *vec)
+{
+    if (!vec) {
+        fprintf(stderr, "vector is null at vector_back()\n");
+        return NULL;
+    }
+
+    if (vec->size == 0) {
+        return NULL;
+    }
+
+    return GET_VECTOR_ELEMENT(vec, vec->size - 1);
+}
+
+void *vector_emplace_back(struct vector *vec)
+{
+    if (!vec) {
+        fprintf(stderr, "vector is null at vector_emplace_back()\n");
+        return NULL;
+    }
+
+    if (!vector_grow(vec, vec->size + 1)) {
+        fprintf(stderr, "realloc failed at vector_emplace_back()\n");
+        return NULL;
+    }
+
+    return GET_VECTOR_ELEMENT(vec, vec->size++);
+}
+
 bool vector_push_back(struct vector *vec, const void *element)
 {
     if (!vec) {
@@ -100,18 +503,11 @@ bool vector_push_back(struct vector *vec, const void *element)
         return false;
     }
 
-    if (vec->size >= vec->capacity) {
-        // Avoid multiplying zero
-        vec->capacity = vec->capacity ? vec->capacity * 2 : 1;
-
-        void *new_block = realloc(vec->items, vec->capacity * vec->e_size);
-        if (!new_block) {
-            fprintf(stderr, "realloc failed at vector_push_back()\n");
-            return false;
-        }
-        vec->items = new_block;
+    if (!vector_grow(vec, vec->size + 1)) {
+        fprintf(stderr, "realloc failed at vector_push_back()\n");
+        return false;
     }
-    
+
     void *dest = GET_VECTOR_ELEMENT(vec, vec->size);
     memcpy(dest, element, vec->e_size);
     vec->size++;
@@ -119,13 +515,123 @@ bool vector_push_back(struct vector *vec, const void *element)
     return true;
 }
 
+bool vector_push_back_n(struct vector *vec, const void *elements, const size_t count)
+{
+    if (!vec) {
+        fprintf(stderr, "vector is null at vector_push_back_n()\n");
+        return false;
+    }
+
+    if (vec->e_size == 0) {
+        fprintf(stderr, "vector is not initialized at vector_push_back_n()\n");
+        return false;
+    }
+
+    if (!elements && count) {
+        fprintf(stderr, "elements is null at vector_push_back_n()\n");
+        return false;
+    }
+
+    if (count > SIZE_MAX / vec->e_size - vec->size) {
+        fprintf(stderr, "count is too large at vector_push_back_n()\n");
+        return false;
+    }
+
+    if (!vector_grow(vec, vec->size + count)) {
+        fprintf(stderr, "realloc failed at vector_push_back_n()\n");
+        return false;
+    }
+
+    if (count) {
+        memcpy(GET_VECTOR_ELEMENT(vec, vec->size), elements, count * vec->e_size);
+        vec->size += count;
+    }
+
+    return true;
+}
+
+bool vector_append_range(struct vector *vec, const struct vector *src, const size_t first, const size_t count)
+{
+    if (!vec || !src) {
+        fprintf(stderr, "vector is null at vector_append_range()\n");
+        return false;
+    }
+
+    if (src->e_size != vec->e_size) {
+        fprintf(stderr, "element sizes differ at vector_append_range()\n");
+        return false;
+    }
+
+    if (first > src->size || count > src->size - first) {
+        fprintf(stderr, "range is out of bounds at vector_append_range()\n");
+        return false;
+    }
+
+    if (src == vec && !vector_reserve(vec, vec->size + count)) {
+        // Grow first, the source range moves along with the block.
+        return false;
+    }
+
+    return vector_push_back_n(vec, GET_ELEMENT(src->items, first, src->e_size), count);
+}
+
+bool vector_reserve(struct vector *vec, const size_t capacity)
+{
+    if (!vec) {
+        fprintf(stderr, "vector is null at vector_reserve()\n");
+        return false;
+    }
+
+    if (vec->e_size == 0) {
+        fprintf(stderr, "vector is not initialized at vector_reserve()\n");
+        return false;
+    }
+
+    if (capacity <= vec->capacity) {
+        return true;
+    }
+
+    if (capacity > SIZE_MAX / vec->e_size) {
+        fprintf(stderr, "capacity is too large at vector_reserve()\n");
+        return false;
+    }
+
+    if (!vector_realloc(vec, capacity)) {
+        fprintf(stderr, "realloc failed at vector_reserve()\n");
+        return false;
+    }
+
+    return true;
+}
+
+bool vector_shrink_to_fit(struct vector *vec)
+{
+    if (!vec) {
+        fprintf(stderr, "vector is null at vector_shrink_to_fit()\n");
+        return false;
+    }
+
+    // Keep one element, realloc to 0 bytes may free the block.
+    const size_t capacity = vec->size ? vec->size : 1;
+    if (capacity == vec->capacity) {
+        return true;
+    }
+
+    if (!vector_realloc(vec, capacity)) {
+        fprintf(stderr, "realloc failed at vector_shrink_to_fit()\n");
+        return false;
+    }
+
+    return true;
+}
+
 /*
 removing C
 
-copying from right (higher memory address) to left (lower memory address)
+moving everything right of it (higher memory address) one slot left (lower memory address)
 
-[A, B, C, D, E] -> [A, B, D, D, E] -> [A, B, D, E, E] -> [A, B, D, E, E] -> vec->size--
-                          ^ memcpy              ^ memcpy
+[A, B, C, D, E] -> [A, B, D, E, E] -> vec->size--
+                          ^^^^ memmove
 */
 
 bool vector_pop_search(struct vector *vec, const void *element)
@@ -146,18 +652,16 @@ bool vector_pop_search(struct vector *vec, const void *element)
         if (memcmp(current, element, vec->e_size) == 0) {
             // Found the element to remove
 
-            // Shift all elements after i one slot to the left
-            for (size_t j = i + 1; j < vec->size; j++) {
-                void *src = GET_VECTOR_ELEMENT(vec, j);      // calculates address at index j
-                void *dest = GET_VECTOR_ELEMENT(vec, j - 1); // calculates address at index just before j
-                memcpy(dest, src, vec->e_size);
+            // Shift all elements after i one slot to the left, in one move
+            if (i < vec->size - 1) {
+                memmove(current, GET_VECTOR_ELEMENT(vec, i + 1), (vec->size - i - 1) * vec->e_size);
             }
 
             vec->size--;
 
             if (vec->size <= vec->capacity / 2 && vec->capacity > 4) {
                 size_t new_capacity = vec->capacity / 2;
-                void *temp = realloc(vec->items, new_capacity * sizeof(vec->e_size));
+                void *temp = realloc(vec->items, new_capacity * vec->e_size);
                 if (!temp) {
                     fprintf(stderr, "failed to shrink vector in vector_pop_search()\n");
                     return false;
@@ -204,7 +708,7 @@ bool vector_pop_index(struct vector *vec, const size_t index, void *element)
 
     if (vec->size <= vec->capacity / 2 && vec->capacity > 4) {
         size_t new_capacity = vec->capacity / 2;
-        void *temp = realloc(vec->items, new_capacity * sizeof(vec->e_size));
+        void *temp = realloc(vec->items, new_capacity * vec->e_size);
         if (!temp) {
             fprintf(stderr, "failed to shrink vector in vector_pop_index()\n");
             return false;
@@ -216,6 +720,86 @@ bool vector_pop_index(struct vector *vec, const size_t index, void *element)
     return true;
 }
 
+size_t vector_remove_if(struct vector *vec, vector_pred_func pred, void *ctx)
+{
+    if (!vec) {
+        fprintf(stderr, "vector is null at vector_remove_if()\n");
+        return 0;
+    }
+
+    if (!pred) {
+        fprintf(stderr, "predicate is null at vector_remove_if()\n");
+        return 0;
+    }
+
+    size_t write = 0; // End of the kept elements
+    size_t run = 0;   // Start of the current run of kept elements, not moved yet
+
+    // Every element is tested once, a removed one ends the run and the run is moved down at once.
+    for (size_t read = 0; read <= vec->size; read++) {
+        if (read < vec->size && !pred(GET_VECTOR_ELEMENT(vec, read), ctx)) {
+            continue;
+        }
+
+        if (read > run && run != write) {
+            memmove(GET_VECTOR_ELEMENT(vec, write), GET_VECTOR_ELEMENT(vec, run), (read - run) * vec->e_size);
+        }
+        write += read - run;
+        run = read + 1;
+    }
+
+    const size_t removed = vec->size - write;
+    vec->size = write;
+
+    return removed;
+}
+
+bool vector_swap_remove(struct vector *vec, const size_t index, void *element)
+{
+    if (!vec) {
+        fprintf(stderr, "vector is null at vector_swap_remove()\n");
+        return false;
+    }
+
+    if (index >= vec->size) {
+        fprintf(stderr, "index is out of bounds at vector_swap_remove()\n");
+        return false;
+    }
+
+    void *ele_ptr = GET_VECTOR_ELEMENT(vec, index);
+    if (element) {
+        memcpy(element, ele_ptr, vec->e_size);
+    }
+
+    if (index < vec->size - 1) {
+        memcpy(ele_ptr, GET_VECTOR_ELEMENT(vec, vec->size - 1), vec->e_size);
+    }
+    vec->size--;
+
+    return true;
+}
+
+bool vector_erase_range(struct vector *vec, const size_t first, const size_t count)
+{
+    if (!vec) {
+        fprintf(stderr, "vector is null at vector_erase_range()\n");
+        return false;
+    }
+
+    if (first > vec->size || count > vec->size - first) {
+        fprintf(stderr, "range is out of bounds at vector_erase_range()\n");
+        return false;
+    }
+
+    const size_t tail = vec->size - first - count;
+    if (count && tail) {
+        memmove(GET_VECTOR_ELEMENT(vec, first), GET_VECTOR_ELEMENT(vec, first + count), tail * vec->e_size);
+    }
+    vec->size -= count;
+
+    return true;
+}
+
 void vector_deinitialize(struct vector *vec)
 {
     if (!vec) {
@@ -5,7 +5,26 @@
 
 /// Comparison function for searching elements.
 /// Should return `true` if the element matches the key.
-typedef bool (*cmp_func)(const void *element, const void *key);
+typedef bool (*vector_cmp_func)(const void *element, const void *key);
+
+/// Predicate for `vector_remove_if()`.
+/// Should return `true` if the element is to be removed.
+typedef bool (*vector_pred_func)(const void *element, void *ctx);
+
+/// Pages are assumed to be this large by `VECTOR_GROW_PAGE`.
+#define VECTOR_PAGE_SIZE 4096
+
+/**
+ * @brief How the vector's capacity grows when an append does not fit.
+ *
+ * Whatever the policy, the capacity always grows to at least the needed size.
+ */
+enum vector_growth {
+    VECTOR_GROW_DOUBLE,     ///< Double the capacity (default).
+    VECTOR_GROW_HALF,       ///< Grow by 1.5x, lets freed blocks be reused by later growth.
+    VECTOR_GROW_CHUNK,      ///< Grow by a fixed `growth_chunk` elements.
+    VECTOR_GROW_PAGE        ///< Double, rounded up to whole pages so large blocks can be remapped.
+};
 
 /**
  * @brief A generic dynamically resizable array (vector).
@@ -15,10 +34,12 @@ typedef bool (*cmp_func)(const void *element, const void *key);
  * retrieval, search, and deletion.
  */
 struct vector {
-    void *items;       ///< Pointer to the contiguous memory block for elements.
-    size_t e_size;     ///< Size of each element in bytes.
-    size_t size;       ///< Current number of elements in the vector.
-    size_t capacity;   ///< Allocated capacity in elements.
+    void *items;               ///< Pointer to the contiguous memory block for elements.
+    size_t e_size;             ///< Size of each element in bytes.
+    size_t size;               ///< Current number of elements in the vector.
+    size_t capacity;           ///< Allocated capacity in elements.
+    enum vector_growth growth; ///< Growth policy, set it after `vector_initialize()`.
+    size_t growth_chunk;       ///< Elements added per growth with `VECTOR_GROW_CHUNK`.
 };
 
 /**
@@ -47,7 +68,32 @@ bool vector_initialize(const size_t capacity, const size_t e_size, struct vector
  *
  * @return `true` if the element is found, `false` otherwise.
  */
-bool vector_search_element(const struct vector *vec, const void *key, void *element, cmp_func cmp);
+bool vector_search_element(const struct vector *vec, const void *key, void *element, vector_cmp_func cmp);
+
+/**
+ * @brief Finds the first element whose bytes equal the key's.
+ *
+ * Elements of 1, 2, 4 or 8 bytes are compared 16 or 32 bytes at a time with
+ * SSE2 or AVX2, picked at runtime, other sizes fall back to `memcmp()`.
+ * Compares raw bytes: padding must be zeroed, and `0.0` and `-0.0` differ.
+ *
+ * @param[in]  vec    Pointer to the initialized vector.
+ * @param[in]  key    Pointer to `e_size` bytes to look for.
+ * @param[out] index  Optional pointer to store the index of the match.
+ *
+ * @return `true` if the element is found, `false` otherwise.
+ */
+bool vector_find_bytes(const struct vector *vec, const void *key, size_t *index);
+
+/**
+ * @brief Counts the elements whose bytes equal the key's, like `vector_find_bytes()`.
+ *
+ * @param[in] vec  Pointer to the initialized vector.
+ * @param[in] key  Pointer to `e_size` bytes to look for.
+ *
+ * @return Number of matching elements.
+ */
+size_t vector_count_bytes(const struct vector *vec, const void *key);
 
 /**
  * @brief Retrieves an element at a specific index.
@@ -62,10 +108,51 @@ bool vector_search_element(const struct vector *vec, const void *key, void *elem
  */
 bool vector_get_element(const struct vector *vec, const size_t index, void *element);
 
+/**
+ * @brief Returns a pointer to the element at a specific index, without copying it.
+ *
+ * The pointer is valid until the vector is reallocated by a growing or shrinking call.
+ *
+ * @param[in] vec    Pointer to the initialized vector.
+ * @param[in] index  Index of the element.
+ *
+ * @return Pointer to the element, `NULL` on invalid index or parameters.
+ */
+void *vector_at(const struct vector *vec, const size_t index);
+
+/**
+ * @brief Returns a pointer to the first element, the elements are contiguous.
+ *
+ * @param[in] vec  Pointer to the initialized vector.
+ *
+ * @return Pointer to the elements, `NULL` if `vec` is null.
+ */
+void *vector_data(const struct vector *vec);
+
+/**
+ * @brief Returns a pointer to the last element, without copying it.
+ *
+ * @param[in] vec  Pointer to the initialized vector.
+ *
+ * @return Pointer to the last element, `NULL` if the vector is empty.
+ */
+void *vector_back(const struct vector *vec);
+
+/**
+ * @brief Appends an uninitialized element and returns it to be constructed in place.
+ *
+ * Grows like `vector_push_back()`.
+ *
+ * @param[in,out] vec  Pointer to the initialized vector.
+ *
+ * @return Pointer to the new element, `NULL` on allocation failure or invalid input.
+ */
+void *vector_emplace_back(struct vector *vec);
+
 /**
  * @brief Appends an element to the end of the vector.
  *
- * Automatically resizes (doubles capacity) if needed. The element is copied
+ * Automatically resizes according to the growth policy if needed. The element is copied
  * using the vector’s element size.
  *
  * @param[in,out] vec      Pointer to the initialized vector.
@@ -75,6 +162,52 @@ bool vector_get_element(const struct vector *vec, const size_t index, void *elem
  */
 bool vector_push_back(struct vector *vec, const void *element);
 
+/**
+ * @brief Appends `count` contiguous elements with a single copy.
+ *
+ * Grows at most once, according to the vector's growth policy.
+ *
+ * @param[in,out] vec       Pointer to the initialized vector.
+ * @param[in]     elements  Pointer to `count` elements of `e_size` bytes.
+ * @param[in]     count     Number of elements to append.
+ *
+ * @return `true` on success, `false` on allocation failure or invalid input.
+ */
+bool vector_push_back_n(struct vector *vec, const void *elements, const size_t count);
+
+/**
+ * @brief Appends a range of another vector's elements.
+ *
+ * @param[in,out] vec    Pointer to the initialized vector.
+ * @param[in]     src    Vector to copy from, with the same element size.
+ * @param[in]     first  Index of the first element to copy.
+ * @param[in]     count  Number of elements to copy.
+ *
+ * @return `true` on success, `false` on allocation failure or invalid input.
+ */
+bool vector_append_range(struct vector *vec, const struct vector *src, const size_t first, const size_t count);
+
+/**
+ * @brief Ensures the vector can hold at least `capacity` elements without reallocating.
+ *
+ * Never shrinks the vector.
+ *
+ * @param[in,out] vec       Pointer to the initialized vector.
+ * @param[in]     capacity  Number of elements to make room for.
+ *
+ * @return `true` on success, `false` on allocation failure or invalid input.
+ */
+bool vector_reserve(struct vector *vec, const size_t capacity);
+
+/**
+ * @brief Releases unused capacity, reallocating to exactly `size` elements.
+ *
+ * @param[in,out] vec  Pointer to the initialized vector.
+ *
+ * @return `true` on success, `false` on allocation failure or invalid input.
+ */
+bool vector_shrink_to_fit(struct vector *vec);
+
 /**
  * @brief Removes the first matching element from the vector.
  *
@@ -102,6 +235,44 @@ bool vector_pop_search(struct vector *vec, const void *element);
  */
 bool vector_pop_index(struct vector *vec, const size_t index, void *element);
 
+/**
+ * @brief Removes every element matching a predicate in a single pass.
+ *
+ * Kept elements are moved down run by run and keep their order. The capacity
+ * is left unchanged, call `vector_shrink_to_fit()` to release it.
+ *
+ * @param[in,out] vec   Pointer to the initialized vector.
+ * @param[in]     pred  Predicate: returns true for elements to remove.
+ * @param[in]     ctx   Context passed to `pred`.
+ *
+ * @return Number of removed elements.
+ */
+size_t vector_remove_if(struct vector *vec, vector_pred_func pred, void *ctx);
+
+/**
+ * @brief Removes the element at the given index by moving the last element into its place.
+ *
+ * O(1), but does not keep the order of the elements.
+ *
+ * @param[in,out] vec      Pointer to the initialized vector.
+ * @param[in]     index    Index of the element to remove.
+ * @param[out]    element  Optional buffer to store the removed element.
+ *
+ * @return `true` on success, `false` on invalid index or input.
+ */
+bool vector_swap_remove(struct vector *vec, const size_t index, void *element);
+
+/**
+ * @brief Removes `count` contiguous elements starting at `first` with a single move.
+ *
+ * @param[in,out] vec    Pointer to the initialized vector.
+ * @param[in]     first  Index of the first element to remove.
+ * @param[in]     count  Number of elements to remove.
+ *
+ * @return `true` on success, `false` on invalid range or input.
+ */
+bool vector_erase_range(struct vector *vec, const size_t first, const size_t count);
+
 /**
  * @brief Frees the internal memory used by the vector.
  *